@@ -1,3 +1,4 @@
+import 'dart:async';
 import 'dart:convert';
 import 'dart:math' as math;
 import 'package:flutter/material.dart';
@@ -81,6 +82,180 @@ class GraphData {
       );
 }
 
+class WindowRow {
+  final int row;
+  final int lane;
+  final String id;
+  final List<String> parents;
+  final List<int> parentRows;
+  final List<int> parentLanes;
+  final List<String> refs;
+  final String author;
+  final String date;
+  final String subject;
+  WindowRow({
+    required this.row,
+    required this.lane,
+    required this.id,
+    required this.parents,
+    required this.parentRows,
+    required this.parentLanes,
+    required this.refs,
+    required this.author,
+    required this.date,
+    required this.subject,
+  });
+  factory WindowRow.fromJson(Map<String, dynamic> j) => WindowRow(
+        row: j['row'],
+        lane: j['lane'],
+        id: j['id'],
+        parents: (j['parents'] as List).cast<String>(),
+        parentRows: (j['parentRows'] as List).cast<int>(),
+        parentLanes: (j['parentLanes'] as List).cast<int>(),
+        refs: (j['refs'] as List).cast<String>(),
+        author: j['author'],
+        date: j['date'],
+        subject: j['subject'],
+      );
+}
+
+// One page of /graph/window: rows [start, start + rows.length) of the full
+// topo order plus the commit each lane is waiting for at `start`.
+class HistoryWindow {
+  final int total;
+  final int start;
+  final int maxLane;
+  final List<String?> lanes;
+  final List<WindowRow> rows;
+  HistoryWindow({
+    required this.total,
+    required this.start,
+    required this.maxLane,
+    required this.lanes,
+    required this.rows,
+  });
+  factory HistoryWindow.fromJson(Map<String, dynamic> j) => HistoryWindow(
+        total: j['total'],
+        start: j['start'],
+        maxLane: j['maxLane'],
+        lanes: (j['lanes'] as List).cast<String?>(),
+        rows: ((j['rows'] as List).map(
+          (e) => WindowRow.fromJson(e as Map<String, dynamic>),
+        )).toList(),
+      );
+}
+
+Future<HistoryWindow> fetchHistoryWindow(
+    String repoPath, int start, int count) async {
+  final resp = await http.post(
+    Uri.parse('http://localhost:8080/graph/window'),
+    headers: {'Content-Type': 'application/json'},
+    body: jsonEncode({'repoPath': repoPath, 'start': start, 'count': count}),
+  );
+  if (resp.statusCode != 200) {
+    throw Exception('后端错误: ${resp.body}');
+  }
+  return HistoryWindow.fromJson(jsonDecode(resp.body) as Map<String, dynamic>);
+}
+
+// Files changed and lines added/removed by one commit against its first
+// parent, as reported by /stats.
+class CommitStats {
+  final int files;
+  final int binaryFiles;
+  final int added;
+  final int removed;
+  CommitStats({
+    required this.files,
+    required this.binaryFiles,
+    required this.added,
+    required this.removed,
+  });
+  factory CommitStats.fromJson(Map<String, dynamic> j) => CommitStats(
+        files: j['files'],
+        binaryFiles: j['binaryFiles'],
+        added: j['added'],
+        removed: j['removed'],
+      );
+  String get summary {
+    final bin = binaryFiles > 0 ? '（二进制 $binaryFiles）' : '';
+    return '文件 $files$bin  +$added / -$removed';
+  }
+}
+
+Future<Map<String, CommitStats>> fetchCommitStats(
+    String repoPath, List<String> commits) async {
+  final resp = await http.post(
+    Uri.parse('http://localhost:8080/stats'),
+    headers: {'Content-Type': 'application/json'},
+    body: jsonEncode({'repoPath': repoPath, 'commits': commits}),
+  );
+  if (resp.statusCode != 200) {
+    throw Exception('后端错误: ${resp.body}');
+  }
+  final j = jsonDecode(resp.body) as Map<String, dynamic>;
+  return {
+    for (final e in (j['stats'] as List).cast<Map<String, dynamic>>())
+      e['id'] as String: CommitStats.fromJson(e),
+  };
+}
+
+// One hit of /search, positioned in the full topo order.
+class SearchMatch {
+  final int row;
+  final int lane;
+  final String id;
+  final List<String> fields;
+  SearchMatch({
+    required this.row,
+    required this.lane,
+    required this.id,
+    required this.fields,
+  });
+  factory SearchMatch.fromJson(Map<String, dynamic> j) => SearchMatch(
+        row: j['row'],
+        lane: j['lane'],
+        id: j['id'],
+        fields: (j['fields'] as List).cast<String>(),
+      );
+}
+
+class SearchResult {
+  final String query;
+  // False when every term is shorter than the index's trigrams; the server
+  // then matches nothing rather than scanning the whole history.
+  final bool searchable;
+  final int total;
+  final List<SearchMatch> matches;
+  SearchResult({
+    required this.query,
+    required this.searchable,
+    required this.total,
+    required this.matches,
+  });
+  factory SearchResult.fromJson(Map<String, dynamic> j) => SearchResult(
+        query: j['query'],
+        searchable: j['searchable'] ?? true,
+        total: j['total'],
+        matches: ((j['matches'] as List).map(
+          (e) => SearchMatch.fromJson(e as Map<String, dynamic>),
+        )).toList(),
+      );
+}
+
+Future<SearchResult> fetchSearch(String repoPath, String query,
+    {int limit = 200}) async {
+  final resp = await http.post(
+    Uri.parse('http://localhost:8080/search'),
+    headers: {'Content-Type': 'application/json'},
+    body: jsonEncode({'repoPath': repoPath, 'query': query, 'limit': limit}),
+  );
+  if (resp.statusCode != 200) {
+    throw Exception('后端错误: ${resp.body}');
+  }
+  return SearchResult.fromJson(jsonDecode(resp.body) as Map<String, dynamic>);
+}
+
 class GraphPage extends StatefulWidget {
   const GraphPage({super.key});
   @override
@@ -90,9 +265,91 @@ class GraphPage extends StatefulWidget {
 class _GraphPageState extends State<GraphPage> {
   final TextEditingController pathCtrl = TextEditingController();
   final TextEditingController limitCtrl = TextEditingController(text: '500');
+  final TextEditingController filterCtrl = TextEditingController();
+  final TextEditingController searchCtrl = TextEditingController();
   GraphData? data;
+  HistoryWindow? firstWindow;
+  String? loadedPath;
+  bool paged = false;
   String? error;
   bool loading = false;
+  SearchResult? search;
+  // The matches the arrows step through: all of [search]'s in the paged
+  // view, only those among the loaded commits in the full-graph view.
+  List<SearchMatch> searchMatches = const [];
+  Set<String> searchIds = const {};
+  int searchIndex = 0;
+  Timer? _searchDebounce;
+  int _searchSeq = 0;
+
+  @override
+  void dispose() {
+    _searchDebounce?.cancel();
+    super.dispose();
+  }
+
+  SearchMatch? get _searchFocus {
+    if (searchMatches.isEmpty) return null;
+    return searchMatches[searchIndex];
+  }
+
+  // "3 / 200", followed by the full count when the server stopped listing
+  // at its limit or some matches are outside the loaded commits.
+  String get _searchCounter {
+    final r = search;
+    if (r == null) return '';
+    final more = r.total > searchMatches.length ? '（共 ${r.total}）' : '';
+    if (!r.searchable) return '请输入更长的关键词';
+    if (searchMatches.isEmpty) {
+      return r.total == 0 ? '无结果' : '已加载部分无结果$more';
+    }
+    return '${searchIndex + 1} / ${searchMatches.length}$more';
+  }
+
+  // Searches as the user types; responses to superseded queries are dropped.
+  void _onSearchChanged(String q) {
+    _searchDebounce?.cancel();
+    _searchDebounce = Timer(const Duration(milliseconds: 150), () async {
+      final path = loadedPath;
+      final seq = ++_searchSeq;
+      if (path == null || q.trim().isEmpty) {
+        setState(() {
+          search = null;
+          searchMatches = const [];
+          searchIds = const {};
+        });
+        return;
+      }
+      try {
+        final r = await fetchSearch(path, q);
+        if (!mounted || seq != _searchSeq) return;
+        // The full-graph view only has the commits it loaded; a match
+        // beyond them has no node to jump to.
+        final loaded = data?.commits.map((c) => c.id).toSet();
+        final matches = loaded == null
+            ? r.matches
+            : r.matches.where((m) => loaded.contains(m.id)).toList();
+        setState(() {
+          search = r;
+          searchMatches = matches;
+          searchIds = matches.map((m) => m.id).toSet();
+          searchIndex = 0;
+        });
+      } catch (e) {
+        if (!mounted || seq != _searchSeq) return;
+        setState(() => error = e.toString());
+      }
+    });
+  }
+
+  void _stepSearch(int delta) {
+    final n = searchMatches.length;
+    if (n == 0) return;
+    setState(() {
+      searchIndex = (searchIndex + delta) % n;
+      if (searchIndex < 0) searchIndex += n;
+    });
+  }
 
   Future<void> _load() async {
     final path = pathCtrl.text.trim();
@@ -105,17 +362,36 @@ class _GraphPageState extends State<GraphPage> {
       loading = true;
       error = null;
       data = null;
+      firstWindow = null;
+      search = null;
+      searchMatches = const [];
+      searchIds = const {};
     });
+    searchCtrl.clear();
     try {
       await http.post(
         Uri.parse('http://localhost:8080/reset'),
         headers: {'Content-Type': 'application/json'},
         body: jsonEncode({'ts': DateTime.now().millisecondsSinceEpoch}),
       );
+      if (paged) {
+        final w = await fetchHistoryWindow(
+            path, 0, _PagedGraphViewState.pageSize);
+        setState(() {
+          firstWindow = w;
+          loadedPath = path;
+          loading = false;
+        });
+        return;
+      }
       final resp = await http.post(
         Uri.parse('http://localhost:8080/graph'),
         headers: {'Content-Type': 'application/json'},
-        body: jsonEncode({'repoPath': path, 'limit': limit}),
+        body: jsonEncode({
+          'repoPath': path,
+          'limit': limit,
+          'path': filterCtrl.text.trim(),
+        }),
       );
       if (resp.statusCode != 200) {
         setState(() {
@@ -128,6 +404,7 @@ class _GraphPageState extends State<GraphPage> {
       final gd = GraphData.fromJson(j);
       setState(() {
         data = gd;
+        loadedPath = path;
         loading = false;
       });
     } catch (e) {
@@ -161,11 +438,33 @@ class _GraphPageState extends State<GraphPage> {
                   width: 120,
                   child: TextField(
                     controller: limitCtrl,
+                    // The paged view walks the whole history window by
+                    // window and has no limit or path filter.
+                    enabled: !paged,
                     decoration: const InputDecoration(labelText: '最近提交数'),
                     keyboardType: TextInputType.number,
                   ),
                 ),
                 const SizedBox(width: 8),
+                SizedBox(
+                  width: 200,
+                  child: TextField(
+                    controller: filterCtrl,
+                    enabled: !paged,
+                    decoration: const InputDecoration(
+                      labelText: '文件路径过滤 reports/annual.docx',
+                    ),
+                  ),
+                ),
+                const SizedBox(width: 8),
+                Checkbox(
+                  value: paged,
+                  onChanged: loading
+                      ? null
+                      : (v) => setState(() => paged = v ?? false),
+                ),
+                const Text('分页'),
+                const SizedBox(width: 8),
                 ElevatedButton(
                   onPressed: loading ? null : _load,
                   child: const Text('加载'),
@@ -173,15 +472,57 @@ class _GraphPageState extends State<GraphPage> {
               ],
             ),
           ),
+          if (loadedPath != null && (data != null || firstWindow != null))
+            Padding(
+              padding: const EdgeInsets.symmetric(horizontal: 8),
+              child: Row(
+                children: [
+                  Expanded(
+                    child: TextField(
+                      controller: searchCtrl,
+                      decoration: const InputDecoration(
+                        labelText: '搜索 提交说明 / 作者 / 分支标签',
+                        prefixIcon: Icon(Icons.search),
+                      ),
+                      onChanged: _onSearchChanged,
+                      onSubmitted: (_) => _stepSearch(1),
+                    ),
+                  ),
+                  const SizedBox(width: 8),
+                  Text(_searchCounter),
+                  IconButton(
+                    icon: const Icon(Icons.keyboard_arrow_up),
+                    onPressed: () => _stepSearch(-1),
+                  ),
+                  IconButton(
+                    icon: const Icon(Icons.keyboard_arrow_down),
+                    onPressed: () => _stepSearch(1),
+                  ),
+                ],
+              ),
+            ),
           if (error != null)
             Padding(
               padding: const EdgeInsets.all(8),
               child: Text(error!, style: const TextStyle(color: Colors.red)),
             ),
           Expanded(
-            child: data == null
-                ? const Center(child: Text('输入路径并点击加载'))
-                : _GraphView(data: data!),
+            child: firstWindow != null
+                ? _PagedGraphView(
+                    key: ValueKey(firstWindow),
+                    repoPath: loadedPath!,
+                    first: firstWindow!,
+                    highlight: searchIds,
+                    focus: _searchFocus,
+                  )
+                : data == null
+                    ? const Center(child: Text('输入路径并点击加载'))
+                    : _GraphView(
+                        repoPath: loadedPath!,
+                        data: data!,
+                        highlight: searchIds,
+                        focus: _searchFocus,
+                      ),
           ),
         ],
       ),
@@ -190,8 +531,16 @@ class _GraphPageState extends State<GraphPage> {
 }
 
 class _GraphView extends StatefulWidget {
+  final String repoPath;
   final GraphData data;
-  const _GraphView({required this.data});
+  final Set<String> highlight;
+  final SearchMatch? focus;
+  const _GraphView({
+    required this.repoPath,
+    required this.data,
+    this.highlight = const {},
+    this.focus,
+  });
   @override
   State<_GraphView> createState() => _GraphViewState();
 }
@@ -212,10 +561,81 @@ class _GraphViewState extends State<_GraphView> {
   final Map<String, GlobalKey> _nodeKeysGV = {};
   Map<String, Offset>? _nodeCenters;
   bool _bakeScheduled = false;
+  static const int _statsPageSize = 100;
+  final Map<String, CommitStats> _stats = {};
+  final Set<String> _statsRequested = {};
+
+  @override
+  void initState() {
+    super.initState();
+    _tc.addListener(_syncStats);
+  }
+
+  @override
+  void dispose() {
+    _tc.removeListener(_syncStats);
+    _tc.dispose();
+    super.dispose();
+  }
+
+  // Requests /stats for the commits on screen that have none yet, at most
+  // [_statsPageSize] per call, as the view is panned and zoomed.
+  void _syncStats() {
+    final centers = _nodeCenters;
+    if (centers == null || _viewSize.isEmpty) return;
+    final view = Rect.fromPoints(_toScene(Offset.zero),
+            _toScene(Offset(_viewSize.width, _viewSize.height)))
+        .inflate(GraphPainter.rowHeight);
+    final want = [
+      for (final e in centers.entries)
+        if (view.contains(e.value) && !_statsRequested.contains(e.key)) e.key,
+    ];
+    for (var i = 0; i < want.length; i += _statsPageSize) {
+      _fetchStats(want.sublist(i, math.min(i + _statsPageSize, want.length)));
+    }
+  }
+
+  Future<void> _fetchStats(List<String> ids) async {
+    final data = widget.data;
+    // Marked before the call and never retried, so a failing server is not
+    // asked again on every pan.
+    _statsRequested.addAll(ids);
+    try {
+      final stats = await fetchCommitStats(widget.repoPath, ids);
+      if (!mounted || !identical(data, widget.data)) return;
+      setState(() => _stats.addAll(stats));
+    } catch (_) {
+      // Stats are decoration; the graph stays usable without them.
+    }
+  }
+
+  String _statsLine(String id) => _stats[id]?.summary ?? '统计加载中';
+
+  Size _viewSize = Size.zero;
+
+  // Centers the view on the focused search match at the current zoom. The
+  // page only offers matches among the loaded commits, so every focus has
+  // a node once the layout is baked.
+  void _jumpToFocus() {
+    final f = widget.focus;
+    final p = f == null ? null : _nodeCenters?[f.id];
+    if (p == null || _viewSize.isEmpty) return;
+    final scale = _tc.value.getMaxScaleOnAxis();
+    _tc.value = Matrix4.identity()
+      ..translate(_viewSize.width / 2 - p.dx * scale,
+          _viewSize.height / 2 - p.dy * scale)
+      ..scale(scale);
+  }
+
   @override
   void didUpdateWidget(covariant _GraphView oldWidget) {
     super.didUpdateWidget(oldWidget);
+    if (!identical(oldWidget.focus, widget.focus)) {
+      WidgetsBinding.instance.addPostFrameCallback((_) => _jumpToFocus());
+    }
     if (!identical(oldWidget.data, widget.data)) {
+      _stats.clear();
+      _statsRequested.clear();
       _branchColors = null;
       _pairBranches = null;
       _canvasSize = null;
@@ -302,12 +722,13 @@ class _GraphViewState extends State<_GraphView> {
                     builder: (_) => AlertDialog(
                       title: Text(hit.subject),
                       content: Text(
-                          'commit ${hit.id}\n${hit.author}\n${hit.date}\nparents: ${hit.parents.join(', ')}'),
+                          'commit ${hit.id}\n${hit.author}\n${hit.date}\nparents: ${hit.parents.join(', ')}\n${_statsLine(hit.id)}'),
                     ),
                   );
                 }
               },
               child: LayoutBuilder(builder: (context, constraints) {
+                _viewSize = Size(constraints.maxWidth, constraints.maxHeight);
                 _graphBaked ??= SizedBox(
                   key: _viewerKey,
                   width: constraints.maxWidth,
@@ -364,6 +785,8 @@ class _GraphViewState extends State<_GraphView> {
                           branchColors: _branchColors!,
                           pairs: _pairBranches!,
                           hoverPairKey: _hoverEdgeKey(),
+                          highlight: widget.highlight,
+                          focusId: widget.focus?.id,
                         ),
                       ),
                     Opacity(opacity: 0.0, child: _graphBaked!),
@@ -475,6 +898,7 @@ class _GraphViewState extends State<_GraphView> {
                       const SizedBox(height: 4),
                       Text('parents: ${_hovered!.parents.join(', ')}'),
                       Text('commit: ${_hovered!.id.substring(0, 7)}'),
+                      Text(_statsLine(_hovered!.id)),
                     ],
                   ),
                 ),
@@ -577,6 +1001,7 @@ class _GraphViewState extends State<_GraphView> {
       setState(() {
         _nodeCenters = centers;
       });
+      _syncStats();
     }
   }
 
@@ -679,7 +1104,7 @@ class _GraphViewState extends State<_GraphView> {
             builder: (_) => AlertDialog(
               title: Text(c.subject),
               content: Text(
-                  'commit ${c.id}\n${c.author}\n${c.date}\nparents: ${c.parents.join(', ')}'),
+                  'commit ${c.id}\n${c.author}\n${c.date}\nparents: ${c.parents.join(', ')}\n${_statsLine(c.id)}'),
             ),
           );
         },
@@ -959,6 +1384,266 @@ class _GraphViewState extends State<_GraphView> {
   }
 }
 
+class _PagedGraphView extends StatefulWidget {
+  final String repoPath;
+  final HistoryWindow first;
+  final Set<String> highlight;
+  final SearchMatch? focus;
+  const _PagedGraphView({
+    super.key,
+    required this.repoPath,
+    required this.first,
+    this.highlight = const {},
+    this.focus,
+  });
+  @override
+  State<_PagedGraphView> createState() => _PagedGraphViewState();
+}
+
+// Virtualized view over /graph/window: only the pages around the viewport
+// are kept, so client memory follows the visible rows rather than the
+// history size.
+class _PagedGraphViewState extends State<_PagedGraphView> {
+  static const int pageSize = 200;
+  static const int _prefetchPages = 1;
+  static const int _keepPages = 2;
+  final TransformationController _tc = TransformationController();
+  final Map<int, HistoryWindow> _pages = {};
+  final Set<int> _inflight = {};
+  Size _viewport = Size.zero;
+  final Map<String, CommitStats> _stats = {};
+  WindowRow? _hovered;
+  Offset? _hoverPos;
+  String? _error;
+
+  int get _total => widget.first.total;
+
+  @override
+  void initState() {
+    super.initState();
+    _pages[0] = widget.first;
+    _fetchStats(widget.first);
+    _tc.addListener(_syncPages);
+  }
+
+  // One batched /stats call per page, dropped again with the page.
+  Future<void> _fetchStats(HistoryWindow w) async {
+    try {
+      final stats = await fetchCommitStats(
+          widget.repoPath, w.rows.map((r) => r.id).toList());
+      if (!mounted || !identical(_pages[w.start ~/ pageSize], w)) return;
+      setState(() => _stats.addAll(stats));
+    } catch (_) {
+      // Stats are decoration; the graph stays usable without them.
+    }
+  }
+
+  String _statsLine(String id) => _stats[id]?.summary ?? '统计加载中';
+
+  @override
+  void didUpdateWidget(covariant _PagedGraphView oldWidget) {
+    super.didUpdateWidget(oldWidget);
+    final f = widget.focus;
+    if (f != null && !identical(oldWidget.focus, f)) _jumpTo(f);
+  }
+
+  // Centers [m] at the current zoom; the transform listener then fetches
+  // the page it lives on.
+  void _jumpTo(SearchMatch m) {
+    if (_viewport.isEmpty) return;
+    final scale = _tc.value.getMaxScaleOnAxis();
+    final x = m.lane * GraphPainter.laneWidth + GraphPainter.laneWidth / 2;
+    final y = m.row * GraphPainter.rowHeight + GraphPainter.rowHeight / 2;
+    _tc.value = Matrix4.identity()
+      ..translate(_viewport.width / 2 - x * scale,
+          _viewport.height / 2 - y * scale)
+      ..scale(scale);
+  }
+
+  @override
+  void dispose() {
+    _tc.removeListener(_syncPages);
+    _tc.dispose();
+    super.dispose();
+  }
+
+  Offset _toScene(Offset p) {
+    final inv = _tc.value.clone()..invert();
+    return MatrixUtils.transformPoint(inv, p);
+  }
+
+  void _syncPages() {
+    if (_viewport.isEmpty || _total == 0) return;
+    final top = _toScene(Offset.zero).dy;
+    final bottom = _toScene(Offset(0, _viewport.height)).dy;
+    final lastPage = (_total - 1) ~/ pageSize;
+    final firstVisible =
+        (top / GraphPainter.rowHeight).floor().clamp(0, _total - 1) ~/
+            pageSize;
+    final lastVisible =
+        (bottom / GraphPainter.rowHeight).floor().clamp(0, _total - 1) ~/
+            pageSize;
+    final want0 = math.max(0, firstVisible - _prefetchPages);
+    final want1 = math.min(lastPage, lastVisible + _prefetchPages);
+    _pages.removeWhere((k, w) {
+      final evict =
+          k < firstVisible - _keepPages || k > lastVisible + _keepPages;
+      if (evict) {
+        for (final r in w.rows) {
+          _stats.remove(r.id);
+        }
+      }
+      return evict;
+    });
+    for (var page = want0; page <= want1; page++) {
+      if (_pages.containsKey(page) || _inflight.contains(page)) continue;
+      _fetchPage(page);
+    }
+  }
+
+  Future<void> _fetchPage(int page) async {
+    _inflight.add(page);
+    try {
+      final w =
+          await fetchHistoryWindow(widget.repoPath, page * pageSize, pageSize);
+      if (!mounted) return;
+      setState(() {
+        _pages[page] = w;
+        _error = null;
+      });
+      _fetchStats(w);
+    } catch (e) {
+      if (!mounted) return;
+      setState(() => _error = e.toString());
+    } finally {
+      _inflight.remove(page);
+    }
+  }
+
+  WindowRow? _hitTest(Offset sceneP) {
+    const laneWidth = GraphPainter.laneWidth;
+    const rowHeight = GraphPainter.rowHeight;
+    final row = (sceneP.dy / rowHeight).floor();
+    if (row < 0 || row >= _total) return null;
+    final page = _pages[row ~/ pageSize];
+    if (page == null) return null;
+    final idx = row - page.start;
+    if (idx < 0 || idx >= page.rows.length) return null;
+    final r = page.rows[idx];
+    final dx = sceneP.dx - (r.lane * laneWidth + laneWidth / 2);
+    final dy = sceneP.dy - (row * rowHeight + rowHeight / 2);
+    if ((dx * dx + dy * dy) <=
+        (GraphPainter.nodeRadius * GraphPainter.nodeRadius * 4)) {
+      return r;
+    }
+    return null;
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    final canvas = Size(
+      (widget.first.maxLane + 1) * GraphPainter.laneWidth + 400,
+      _total * GraphPainter.rowHeight + 400,
+    );
+    return Stack(
+      children: [
+        LayoutBuilder(builder: (context, constraints) {
+          final vp = Size(constraints.maxWidth, constraints.maxHeight);
+          if (vp != _viewport) {
+            _viewport = vp;
+            WidgetsBinding.instance.addPostFrameCallback((_) => _syncPages());
+          }
+          return MouseRegion(
+            onHover: (d) {
+              final hit = _hitTest(_toScene(d.localPosition));
+              setState(() {
+                _hovered = hit;
+                _hoverPos = d.localPosition;
+              });
+            },
+            onExit: (_) => setState(() {
+              _hovered = null;
+              _hoverPos = null;
+            }),
+            child: GestureDetector(
+              onTapUp: (d) {
+                final hit = _hitTest(_toScene(d.localPosition));
+                if (hit != null) {
+                  showDialog(
+                    context: context,
+                    builder: (_) => AlertDialog(
+                      title: Text(hit.subject),
+                      content: Text(
+                          'commit ${hit.id}\n${hit.author}\n${hit.date}\nparents: ${hit.parents.join(', ')}\n${_statsLine(hit.id)}'),
+                    ),
+                  );
+                }
+              },
+              child: InteractiveViewer(
+                transformationController: _tc,
+                minScale: 0.2,
+                maxScale: 4,
+                constrained: false,
+                boundaryMargin: const EdgeInsets.all(200),
+                child: CustomPaint(
+                  size: canvas,
+                  painter: PagedGraphPainter(
+                    pages: _pages.values.toList(),
+                    highlight: widget.highlight,
+                    focusId: widget.focus?.id,
+                  ),
+                ),
+              ),
+            ),
+          );
+        }),
+        if (_error != null)
+          Positioned(
+            left: 8,
+            bottom: 8,
+            child: Text(_error!, style: const TextStyle(color: Colors.red)),
+          ),
+        if (_hovered != null && _hoverPos != null)
+          Positioned(
+            left: _hoverPos!.dx + 12,
+            top: _hoverPos!.dy + 12,
+            child: Material(
+              elevation: 2,
+              color: Colors.transparent,
+              child: Container(
+                constraints: const BoxConstraints(maxWidth: 400),
+                padding: const EdgeInsets.all(8),
+                decoration: BoxDecoration(
+                  color: const Color(0xFFFAFAFA),
+                  borderRadius: BorderRadius.circular(6),
+                  boxShadow: const [
+                    BoxShadow(color: Color(0x33000000), blurRadius: 6),
+                  ],
+                ),
+                child: DefaultTextStyle(
+                  style: const TextStyle(color: Colors.black, fontSize: 12),
+                  child: Column(
+                    crossAxisAlignment: CrossAxisAlignment.start,
+                    mainAxisSize: MainAxisSize.min,
+                    children: [
+                      Text(_hovered!.subject),
+                      const SizedBox(height: 4),
+                      Text('${_hovered!.author}  ${_hovered!.date}'),
+                      const SizedBox(height: 4),
+                      Text('parents: ${_hovered!.parents.join(', ')}'),
+                      Text('commit: ${_hovered!.id.substring(0, 7)}'),
+                      Text(_statsLine(_hovered!.id)),
+                    ],
+                  ),
+                ),
+              ),
+            ),
+          ),
+      ],
+    );
+  }
+}
+
 class GraphPainter extends CustomPainter {
   final GraphData data;
   final Map<String, Color> branchColors;
@@ -1205,18 +1890,153 @@ class GraphPainter extends CustomPainter {
   }
 }
 
+// Paints the loaded /graph/window pages. Lanes come from the server, so a
+// page can be drawn without any of the rows above it; edges whose child row
+// is not loaded are recovered from the page's lane state.
+class PagedGraphPainter extends CustomPainter {
+  final List<HistoryWindow> pages;
+  final Set<String> highlight;
+  final String? focusId;
+  PagedGraphPainter({
+    required this.pages,
+    this.highlight = const {},
+    this.focusId,
+  });
+
+  Color _laneColor(int lane) =>
+      GraphPainter.lanePalette[lane % GraphPainter.lanePalette.length];
+
+  @override
+  void paint(Canvas canvas, Size size) {
+    const laneWidth = GraphPainter.laneWidth;
+    const rowHeight = GraphPainter.rowHeight;
+    final paintNode = Paint()..color = const Color(0xFF1976D2);
+    final paintEdge = Paint()
+      ..strokeWidth = 2
+      ..style = PaintingStyle.stroke;
+    final loaded = <String, WindowRow>{};
+    for (final page in pages) {
+      for (final r in page.rows) {
+        loaded[r.id] = r;
+      }
+    }
+
+    // Lines entering a page from rows that are not loaded.
+    for (final page in pages) {
+      final top = page.start * rowHeight.toDouble();
+      final pageEnd = (page.start + page.rows.length) * rowHeight.toDouble();
+      for (var lane = 0; lane < page.lanes.length; lane++) {
+        final waiting = page.lanes[lane];
+        if (waiting == null) continue;
+        final target = loaded[waiting];
+        final x = lane * laneWidth + laneWidth / 2;
+        final y1 = target != null && target.row >= page.start
+            ? math.min(target.row * rowHeight + rowHeight / 2, pageEnd)
+            : pageEnd;
+        final path = Path()..moveTo(x, top);
+        if (target != null && target.lane != lane && y1 < pageEnd) {
+          final tx = target.lane * laneWidth + laneWidth / 2;
+          path.cubicTo(x, (top + y1) / 2, tx, (top + y1) / 2, tx, y1);
+        } else {
+          path.lineTo(x, y1);
+        }
+        paintEdge.color = _laneColor(lane);
+        canvas.drawPath(path, paintEdge);
+      }
+    }
+
+    for (final page in pages) {
+      for (final r in page.rows) {
+        final x = r.lane * laneWidth + laneWidth / 2;
+        final y = r.row * rowHeight + rowHeight / 2;
+        for (var i = 0; i < r.parentRows.length; i++) {
+          final pr = r.parentRows[i];
+          final pl = r.parentLanes[i];
+          if (pr < 0 || pl < 0) continue;
+          final px = pl * laneWidth + laneWidth / 2;
+          final py = pr * rowHeight + rowHeight / 2;
+          final dLane = (r.lane - pl).abs();
+          final bendBase = (dLane * 8.0).clamp(8.0, 24.0);
+          final dir = r.lane <= pl ? 1.0 : -1.0;
+          final midY = (y + py) / 2;
+          final path = Path()
+            ..moveTo(x, y)
+            ..cubicTo(x + dir * bendBase, midY, px - dir * bendBase, midY, px,
+                py);
+          paintEdge.color = _laneColor(i == 0 ? r.lane : pl);
+          canvas.drawPath(path, paintEdge);
+        }
+      }
+    }
+
+    final textPainter = TextPainter(textDirection: TextDirection.ltr);
+    for (final page in pages) {
+      for (final r in page.rows) {
+        final x = r.lane * laneWidth + laneWidth / 2;
+        final y = r.row * rowHeight + rowHeight / 2;
+        canvas.drawCircle(Offset(x, y), GraphPainter.nodeRadius, paintNode);
+        if (highlight.contains(r.id)) {
+          _drawSearchRing(canvas, Offset(x, y), r.id == focusId);
+        }
+        final label = r.id.substring(0, 7) +
+            (r.refs.isNotEmpty ? ' [' + r.refs.first + ']' : '');
+        textPainter.text = TextSpan(
+          text: label,
+          style: const TextStyle(color: Colors.black, fontSize: 12),
+        );
+        textPainter.layout();
+        textPainter.paint(canvas, Offset(x + 10, y - 8));
+      }
+    }
+  }
+
+  @override
+  bool shouldRepaint(covariant PagedGraphPainter oldDelegate) {
+    if (oldDelegate.pages.length != pages.length) return true;
+    for (var i = 0; i < pages.length; i++) {
+      final a = oldDelegate.pages[i];
+      final b = pages[i];
+      // A refetched page is a new object even when it covers the same rows.
+      if (a.start != b.start ||
+          a.rows.length != b.rows.length ||
+          !identical(a, b)) {
+        return true;
+      }
+    }
+    return !identical(oldDelegate.highlight, highlight) ||
+        oldDelegate.focusId != focusId;
+  }
+}
+
+// Ring around a commit matched by the search box; the focused match gets
+// a heavier one.
+void _drawSearchRing(Canvas canvas, Offset center, bool focused) {
+  canvas.drawCircle(
+    center,
+    GraphPainter.nodeRadius + (focused ? 6 : 4),
+    Paint()
+      ..color = const Color(0xFFFF9800)
+      ..style = PaintingStyle.stroke
+      ..strokeWidth = focused ? 3 : 2,
+  );
+}
+
 class BakedPainter extends CustomPainter {
   final Map<String, Offset> centers;
   final GraphData data;
   final Map<String, Color> branchColors;
   final Map<String, List<String>> pairs;
   final String? hoverPairKey;
+  final Set<String> highlight;
+  final String? focusId;
   BakedPainter({
     required this.centers,
     required this.data,
     required this.branchColors,
     required this.pairs,
     required this.hoverPairKey,
+    this.highlight = const {},
+    this.focusId,
   });
   @override
   void paint(Canvas canvas, Size size) {
@@ -1254,13 +2074,18 @@ class BakedPainter extends CustomPainter {
       final p = centers[c.id];
       if (p == null) continue;
       canvas.drawCircle(p, 6, paintNode);
+      if (highlight.contains(c.id)) {
+        _drawSearchRing(canvas, p, c.id == focusId);
+      }
     }
   }
 
   @override
   bool shouldRepaint(covariant BakedPainter oldDelegate) {
     return oldDelegate.centers != centers ||
-        oldDelegate.hoverPairKey != hoverPairKey;
+        oldDelegate.hoverPairKey != hoverPairKey ||
+        !identical(oldDelegate.highlight, highlight) ||
+        oldDelegate.focusId != focusId;
   }
 }
 
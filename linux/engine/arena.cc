@@ -0,0 +1,25 @@
+#include "arena.h"
+
+#include <algorithm>
+
+Arena::Arena(size_t block_size)
+    : block_size_(std::max<size_t>(block_size, 1)) {}
+
+void* Arena::AllocateBytes(size_t size, size_t align) {
+  auto aligned = [align](uint8_t* p) {
+    const uintptr_t a = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<uint8_t*>((a + align - 1) & ~(align - 1));
+  };
+  uint8_t* p = cursor_ == nullptr ? nullptr : aligned(cursor_);
+  if (p == nullptr || p > end_ || static_cast<size_t>(end_ - p) < size) {
+    // new[] storage is aligned for any fundamental type, so a fresh block
+    // needs no padding.
+    const size_t block = std::max(block_size_, size);
+    blocks_.emplace_back(new uint8_t[block]);
+    bytes_ += block;
+    p = blocks_.back().get();
+    end_ = p + block;
+  }
+  cursor_ = p + size;
+  return p;
+}
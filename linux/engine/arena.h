@@ -0,0 +1,53 @@
+#ifndef ENGINE_ARENA_H_
+#define ENGINE_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for data that is built once and freed all at once. Blocks
+// are never reused or released individually; destroying the arena frees
+// them in one go, however many objects were carved out of them. Callers
+// that know their total size up front get a single block.
+class Arena {
+ public:
+  explicit Arena(size_t block_size = 1 << 20);
+  Arena(Arena&&) = default;
+  Arena& operator=(Arena&&) = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Uninitialized storage for |count| values of |T|.
+  template <typename T>
+  T* Allocate(size_t count) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "arena memory is never destructed");
+    return static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T)));
+  }
+
+  template <typename T>
+  T* Copy(const std::vector<T>& values) {
+    T* out = Allocate<T>(values.size());
+    if (!values.empty()) {
+      std::memcpy(out, values.data(), values.size() * sizeof(T));
+    }
+    return out;
+  }
+
+  // Bytes obtained from the system so far.
+  size_t bytes() const { return bytes_; }
+
+ private:
+  void* AllocateBytes(size_t size, size_t align);
+
+  size_t block_size_;
+  std::vector<std::unique_ptr<uint8_t[]>> blocks_;
+  uint8_t* cursor_ = nullptr;
+  uint8_t* end_ = nullptr;
+  size_t bytes_ = 0;
+};
+
+#endif  // ENGINE_ARENA_H_
@@ -0,0 +1,721 @@
+#include "backup.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "chunk_store.h"
+#include "chunker.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+
+namespace {
+
+// Bytes of file data held for one round of hashing and compression. Files
+// are read straight into this buffer and cut in place.
+constexpr size_t kBatchBytes = 32 * 1024 * 1024;
+static_assert(kBatchBytes >= 2 * ChunkParams::kMaxSize,
+              "a batch must hold at least one full chunk");
+
+int64_t Nanoseconds(const timespec& ts) {
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+timespec Timespec(int64_t ns) {
+  timespec ts;
+  ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+  ts.tv_nsec = static_cast<long>(ns % 1000000000);
+  if (ts.tv_nsec < 0) {
+    ts.tv_sec--;
+    ts.tv_nsec += 1000000000;
+  }
+  return ts;
+}
+
+bool IsValidName(const std::string& name) {
+  return !name.empty() && name[0] != '.' &&
+         name.find('/') == std::string::npos;
+}
+
+// "<name>/<timestamp>" as printed by backup and list.
+bool IsValidSnapshotId(const std::string& id) {
+  const size_t slash = id.find('/');
+  return slash != std::string::npos && IsValidName(id.substr(0, slash)) &&
+         IsValidName(id.substr(slash + 1));
+}
+
+bool EndsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Sorted names in |dir|, without dot entries and unfinished manifests.
+bool ListDir(const std::string& dir,
+             std::vector<std::string>* names,
+             std::string* error) {
+  names->clear();
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr) {
+    if (errno == ENOENT) return true;
+    *error = "cannot read " + dir + ": " + std::strerror(errno);
+    return false;
+  }
+  while (dirent* e = readdir(d)) {
+    if (e->d_name[0] != '.' && !EndsWith(e->d_name, ".tmp")) {
+      names->push_back(e->d_name);
+    }
+  }
+  closedir(d);
+  std::sort(names->begin(), names->end());
+  return true;
+}
+
+// Backups of one name within the same second are "<stamp>", "<stamp>-2",
+// "<stamp>-3" and so on. Compares those ids oldest first; plain string
+// order would put "-10" before "-2".
+bool StampLess(const std::string& a, const std::string& b) {
+  auto split = [](const std::string& id, uint64_t* n) {
+    const size_t dash = id.rfind('-');
+    *n = 1;
+    if (dash == std::string::npos || dash + 1 == id.size() ||
+        id.size() - dash - 1 > 9 ||
+        id.find_first_not_of("0123456789", dash + 1) != std::string::npos) {
+      return id.size();
+    }
+    *n = std::strtoull(id.c_str() + dash + 1, nullptr, 10);
+    return dash;
+  };
+  uint64_t na, nb;
+  const size_t la = split(a, &na);
+  const size_t lb = split(b, &nb);
+  const int base = a.compare(0, la, b, 0, lb);
+  if (base != 0) return base < 0;
+  if (na != nb) return na < nb;
+  return a < b;
+}
+
+// Snapshot ids under |name_dir|, oldest first.
+bool ListStamps(const std::string& name_dir,
+                std::vector<std::string>* stamps,
+                std::string* error) {
+  if (!ListDir(name_dir, stamps, error)) return false;
+  std::sort(stamps->begin(), stamps->end(), StampLess);
+  return true;
+}
+
+// Exclusive flock on one name's snapshot directory, held while a backup
+// picks its id and writes its manifest, so two backups of the same name in
+// the same second cannot pick the same id.
+class NameLock {
+ public:
+  NameLock() = default;
+  ~NameLock() {
+    if (fd_ >= 0) close(fd_);
+  }
+  NameLock(const NameLock&) = delete;
+  NameLock& operator=(const NameLock&) = delete;
+
+  bool Lock(const std::string& dir, std::string* error) {
+    fd_ = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int rc = -1;
+    if (fd_ >= 0) {
+      do {
+        rc = flock(fd_, LOCK_EX);
+      } while (rc != 0 && errno == EINTR);
+    }
+    if (rc != 0) {
+      *error = "cannot lock " + dir + ": " + std::strerror(errno);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+bool IsEmptyDir(const std::string& path) {
+  DIR* d = opendir(path.c_str());
+  if (d == nullptr) return false;
+  bool empty = true;
+  while (dirent* e = readdir(d)) {
+    if (std::strcmp(e->d_name, ".") != 0 && std::strcmp(e->d_name, "..") != 0) {
+      empty = false;
+      break;
+    }
+  }
+  closedir(d);
+  return empty;
+}
+
+struct TreeWalker {
+  std::string root;
+  // The store, when it lives inside the tree being backed up.
+  dev_t skip_dev = 0;
+  ino_t skip_ino = 0;
+  std::vector<SnapshotEntry>* entries;
+
+  bool Walk(const std::string& rel, std::string* error) {
+    const std::string dir = rel.empty() ? root : root + "/" + rel;
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) {
+      // Removed since its parent was listed, e.g. by git gc.
+      if (errno == ENOENT && !rel.empty()) return true;
+      *error = "cannot read " + dir + ": " + std::strerror(errno);
+      return false;
+    }
+    struct Child {
+      std::string name;
+      struct stat st;
+      std::string target;
+    };
+    std::vector<Child> children;
+    bool ok = true;
+    while (dirent* e = readdir(d)) {
+      if (std::strcmp(e->d_name, ".") == 0 ||
+          std::strcmp(e->d_name, "..") == 0) {
+        continue;
+      }
+      Child c;
+      c.name = e->d_name;
+      if (fstatat(dirfd(d), e->d_name, &c.st, AT_SYMLINK_NOFOLLOW) != 0) {
+        if (errno == ENOENT) continue;
+        *error = "cannot stat " + dir + "/" + c.name + ": " +
+                 std::strerror(errno);
+        ok = false;
+        break;
+      }
+      if (S_ISLNK(c.st.st_mode)) {
+        char target[PATH_MAX];
+        const ssize_t n = readlinkat(dirfd(d), e->d_name, target,
+                                     sizeof(target));
+        if (n < 0) continue;
+        c.target.assign(target, static_cast<size_t>(n));
+      } else if (!S_ISDIR(c.st.st_mode) && !S_ISREG(c.st.st_mode)) {
+        continue;  // Sockets, fifos and devices have no content to keep.
+      }
+      children.push_back(std::move(c));
+    }
+    closedir(d);
+    if (!ok) return false;
+    std::sort(children.begin(), children.end(),
+              [](const Child& a, const Child& b) { return a.name < b.name; });
+
+    for (const Child& c : children) {
+      SnapshotEntry e;
+      e.path = rel.empty() ? c.name : rel + "/" + c.name;
+      e.mode = c.st.st_mode & 07777;
+      e.mtime_ns = Nanoseconds(c.st.st_mtim);
+      if (S_ISDIR(c.st.st_mode)) {
+        if (c.st.st_dev == skip_dev && c.st.st_ino == skip_ino) continue;
+        e.type = SnapshotEntry::kDirectory;
+        entries->push_back(e);
+        if (!Walk(e.path, error)) return false;
+      } else if (S_ISLNK(c.st.st_mode)) {
+        e.type = SnapshotEntry::kSymlink;
+        e.target = c.target;
+        entries->push_back(std::move(e));
+      } else {
+        e.type = SnapshotEntry::kFile;
+        e.size = static_cast<uint64_t>(c.st.st_size);
+        e.ctime_ns = Nanoseconds(c.st.st_ctim);
+        e.inode = c.st.st_ino;
+        entries->push_back(std::move(e));
+      }
+    }
+    return true;
+  }
+};
+
+// Reads files into one buffer, cuts them into chunks there, and when the
+// buffer is full hashes and stores the chunks on the pool.
+class ChunkBatch {
+ public:
+  ChunkBatch(ChunkStore* store,
+             ThreadPool* pool,
+             int level,
+             std::vector<SnapshotEntry>* entries,
+             BackupStats* stats)
+      : store_(store),
+        pool_(pool),
+        level_(level),
+        entries_(entries),
+        stats_(stats),
+        buffer_(new uint8_t[kBatchBytes]),
+        scratch_(pool->size()) {}
+
+  // Chunks the file at |path| into entry |index|. |vanished| is set when
+  // the file no longer exists.
+  bool AddFile(const std::string& path,
+               size_t index,
+               bool* vanished,
+               std::string* error) {
+    *vanished = false;
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+      if (errno == ENOENT) {
+        *vanished = true;
+        return true;
+      }
+      *error = "cannot open " + path + ": " + std::strerror(errno);
+      return false;
+    }
+    SnapshotEntry& entry = (*entries_)[index];
+    entry.chunks.clear();
+    uint64_t total = 0;
+    size_t have = 0;  // Bytes read past used_ and not yet cut.
+    bool eof = false;
+    bool ok = true;
+    while (ok) {
+      while (!eof && used_ + have < kBatchBytes) {
+        const ssize_t n = read(fd, buffer_.get() + used_ + have,
+                               kBatchBytes - used_ - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+          *error = "cannot read " + path + ": " + std::strerror(errno);
+          ok = false;
+          break;
+        }
+        if (n == 0) eof = true;
+        have += static_cast<size_t>(n);
+        total += static_cast<uint64_t>(n);
+      }
+      if (!ok) break;
+      // Without the end of the file in sight, only cut where a full
+      // maximum-size window is available.
+      while (have > 0 && (eof || have >= ChunkParams::kMaxSize)) {
+        const size_t size = FindChunkEnd(buffer_.get() + used_, have);
+        pending_.push_back({used_, static_cast<uint32_t>(size), index,
+                            entry.chunks.size()});
+        entry.chunks.push_back({{}, static_cast<uint32_t>(size)});
+        used_ += size;
+        have -= size;
+      }
+      if (eof) break;
+      const size_t tail = used_;
+      ok = Flush(error);
+      std::memmove(buffer_.get(), buffer_.get() + tail, have);
+    }
+    close(fd);
+    entry.size = total;
+    stats_->scanned_bytes += total;
+    return ok;
+  }
+
+  bool Flush(std::string* error) {
+    std::mutex error_mutex;
+    std::atomic<uint64_t> new_chunks{0};
+    std::atomic<uint64_t> new_bytes{0};
+    std::atomic<uint64_t> stored_bytes{0};
+    pool_->ParallelFor(pending_.size(), [&](size_t i, size_t worker) {
+      const Pending& p = pending_[i];
+      const uint8_t* data = buffer_.get() + p.offset;
+      const Sha256Digest digest = Sha256::Of(data, p.size);
+      (*entries_)[p.entry].chunks[p.chunk].digest = digest;
+      size_t written = 0;
+      std::string put_error;
+      if (!store_->Put(digest, data, p.size, level_, &scratch_[worker],
+                       &written, &put_error)) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (error->empty()) *error = put_error;
+        return;
+      }
+      if (written != 0) {
+        new_chunks++;
+        new_bytes += p.size;
+        stored_bytes += written;
+      }
+    });
+    stats_->new_chunks += new_chunks;
+    stats_->new_bytes += new_bytes;
+    stats_->stored_bytes += stored_bytes;
+    pending_.clear();
+    used_ = 0;
+    return error->empty();
+  }
+
+ private:
+  struct Pending {
+    size_t offset;
+    uint32_t size;
+    size_t entry;
+    size_t chunk;
+  };
+
+  ChunkStore* store_;
+  ThreadPool* pool_;
+  int level_;
+  std::vector<SnapshotEntry>* entries_;
+  BackupStats* stats_;
+  std::unique_ptr<uint8_t[]> buffer_;
+  size_t used_ = 0;  // Bytes of buffer_ taken by pending_ chunks.
+  std::vector<Pending> pending_;
+  std::vector<std::vector<uint8_t>> scratch_;  // One per pool worker.
+};
+
+bool Reusable(const SnapshotEntry& now,
+              const SnapshotEntry& before,
+              const ChunkStore& store) {
+  if (before.type != SnapshotEntry::kFile || before.size != now.size ||
+      before.mtime_ns != now.mtime_ns || before.ctime_ns != now.ctime_ns ||
+      before.inode != now.inode) {
+    return false;
+  }
+  for (const ChunkRef& c : before.chunks) {
+    if (!store.Contains(c.digest)) return false;
+  }
+  return true;
+}
+
+std::string Timestamp(time_t t) {
+  tm utc;
+  gmtime_r(&t, &utc);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), "%Y%m%dT%H%M%SZ", &utc);
+  return buf;
+}
+
+bool WriteFileChunks(const ChunkStore& store,
+                     const SnapshotEntry& e,
+                     const std::string& path,
+                     std::vector<uint8_t>* buffer,
+                     std::string* error) {
+  uint64_t total = 0;
+  for (const ChunkRef& c : e.chunks) total += c.size;
+  if (total != e.size) {
+    *error = "chunk sizes of " + e.path + " do not add up";
+    return false;
+  }
+  const int fd = open(path.c_str(),
+                      O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                      0600);
+  if (fd < 0) {
+    *error = "cannot create " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  bool ok = true;
+  for (const ChunkRef& c : e.chunks) {
+    if (!store.Get(c.digest, c.size, buffer, error)) {
+      ok = false;
+      break;
+    }
+    size_t done = 0;
+    while (ok && done < buffer->size()) {
+      const ssize_t n =
+          write(fd, buffer->data() + done, buffer->size() - done);
+      if (n < 0 && errno == EINTR) continue;
+      ok = n > 0;
+      if (ok) done += static_cast<size_t>(n);
+    }
+    if (!ok) {
+      *error = "cannot write " + path + ": " + std::strerror(errno);
+      break;
+    }
+  }
+  if (ok) {
+    const timespec times[2] = {Timespec(e.mtime_ns), Timespec(e.mtime_ns)};
+    fchmod(fd, e.mode);
+    futimens(fd, times);
+  }
+  if (close(fd) != 0 && ok) {
+    *error = "cannot write " + path + ": " + std::strerror(errno);
+    ok = false;
+  }
+  return ok;
+}
+
+}  // namespace
+
+bool RunBackup(const BackupOptions& options,
+               ThreadPool* pool,
+               std::string* snapshot,
+               BackupStats* stats,
+               std::string* error) {
+  *stats = BackupStats();
+  char real[PATH_MAX];
+  struct stat source_st;
+  if (realpath(options.source.c_str(), real) == nullptr ||
+      stat(real, &source_st) != 0) {
+    *error = "cannot open " + options.source + ": " + std::strerror(errno);
+    return false;
+  }
+  if (!S_ISDIR(source_st.st_mode)) {
+    *error = options.source + " is not a directory";
+    return false;
+  }
+  std::string name = options.name;
+  if (name.empty()) {
+    name = real;
+    name = name.substr(name.rfind('/') + 1);
+  }
+  if (!IsValidName(name)) {
+    *error = "invalid snapshot name \"" + name + "\"";
+    return false;
+  }
+
+  ChunkStore store;
+  // Shared for the whole run: prune waits until this backup's manifest is
+  // written, and cannot remove the chunks it is about to reference.
+  if (!store.Open(options.store, true, ChunkStore::Access::kShared, error)) {
+    return false;
+  }
+  Snapshot snap;
+  snap.source = real;
+  snap.time = std::time(nullptr);
+  TreeWalker walker;
+  walker.root = real;
+  walker.entries = &snap.entries;
+  struct stat store_st;
+  if (stat(store.root().c_str(), &store_st) == 0) {
+    walker.skip_dev = store_st.st_dev;
+    walker.skip_ino = store_st.st_ino;
+  }
+  if (!walker.Walk("", error)) return false;
+
+  // The newest snapshot of this name decides which files can be skipped.
+  const std::string name_dir = store.snapshots_dir() + "/" + name;
+  std::vector<std::string> stamps;
+  if (!ListStamps(name_dir, &stamps, error)) return false;
+  Snapshot previous;
+  std::unordered_map<std::string, const SnapshotEntry*> previous_files;
+  if (!stamps.empty() && !options.rescan) {
+    if (!ReadSnapshot(name_dir + "/" + stamps.back(), &previous, error)) {
+      return false;
+    }
+    for (const SnapshotEntry& e : previous.entries) {
+      previous_files.emplace(e.path, &e);
+    }
+  }
+
+  ChunkBatch batch(&store, pool, options.level, &snap.entries, stats);
+  std::vector<bool> vanished(snap.entries.size());
+  for (size_t i = 0; i < snap.entries.size(); i++) {
+    SnapshotEntry& e = snap.entries[i];
+    if (e.type != SnapshotEntry::kFile) continue;
+    const auto it = previous_files.find(e.path);
+    if (it != previous_files.end() && Reusable(e, *it->second, store)) {
+      e.chunks = it->second->chunks;
+      stats->reused_files++;
+      continue;
+    }
+    bool gone = false;
+    if (!batch.AddFile(snap.source + "/" + e.path, i, &gone, error)) {
+      return false;
+    }
+    vanished[i] = gone;
+  }
+  if (!batch.Flush(error)) return false;
+
+  size_t kept = 0;
+  for (size_t i = 0; i < snap.entries.size(); i++) {
+    if (vanished[i]) continue;
+    SnapshotEntry& e = snap.entries[i];
+    if (e.type == SnapshotEntry::kFile) {
+      stats->files++;
+      stats->total_bytes += e.size;
+      stats->chunks += e.chunks.size();
+    }
+    if (kept != i) snap.entries[kept] = std::move(e);
+    kept++;
+  }
+  snap.entries.resize(kept);
+
+  if (mkdir(name_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    *error = "cannot create " + name_dir + ": " + std::strerror(errno);
+    return false;
+  }
+  // Every chunk the manifest names, and name_dir itself, must be on disk
+  // before the manifest is.
+  if (!store.Sync(error)) return false;
+  NameLock name_lock;
+  if (!name_lock.Lock(name_dir, error)) return false;
+  const std::string stamp = Timestamp(static_cast<time_t>(snap.time));
+  std::string id = stamp;
+  for (int n = 2; access((name_dir + "/" + id).c_str(), F_OK) == 0; n++) {
+    id = stamp + "-" + std::to_string(n);
+  }
+  if (!WriteSnapshot(name_dir + "/" + id, snap, error)) return false;
+  *snapshot = name + "/" + id;
+  return true;
+}
+
+bool RestoreSnapshot(const std::string& store_root,
+                     const std::string& snapshot,
+                     const std::string& dest,
+                     ThreadPool* pool,
+                     std::string* error) {
+  if (!IsValidSnapshotId(snapshot)) {
+    *error = "invalid snapshot id \"" + snapshot + "\"";
+    return false;
+  }
+  ChunkStore store;
+  if (!store.Open(store_root, false, ChunkStore::Access::kShared, error)) {
+    return false;
+  }
+  Snapshot snap;
+  if (!ReadSnapshot(store.snapshots_dir() + "/" + snapshot, &snap, error)) {
+    return false;
+  }
+  if (mkdir(dest.c_str(), 0755) != 0) {
+    if (errno != EEXIST) {
+      *error = "cannot create " + dest + ": " + std::strerror(errno);
+      return false;
+    }
+    if (!IsEmptyDir(dest)) {
+      *error = dest + " is not an empty directory";
+      return false;
+    }
+  }
+
+  // Directories first so files can be created in them, writable until
+  // their own modes are applied last. Symlinks come after the files so no
+  // file is ever written through one.
+  std::vector<size_t> files;
+  for (size_t i = 0; i < snap.entries.size(); i++) {
+    const SnapshotEntry& e = snap.entries[i];
+    if (e.type == SnapshotEntry::kFile) {
+      files.push_back(i);
+    } else if (e.type == SnapshotEntry::kDirectory) {
+      const std::string path = dest + "/" + e.path;
+      if (mkdir(path.c_str(), 0700) != 0) {
+        *error = "cannot create " + path + ": " + std::strerror(errno);
+        return false;
+      }
+    }
+  }
+
+  std::mutex error_mutex;
+  std::atomic<bool> failed{false};
+  std::vector<std::vector<uint8_t>> buffers(pool->size());
+  pool->ParallelFor(files.size(), [&](size_t i, size_t worker) {
+    if (failed) return;
+    const SnapshotEntry& e = snap.entries[files[i]];
+    std::string file_error;
+    if (!WriteFileChunks(store, e, dest + "/" + e.path, &buffers[worker],
+                         &file_error)) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!failed) *error = file_error;
+      failed = true;
+    }
+  });
+  if (failed) return false;
+
+  for (const SnapshotEntry& e : snap.entries) {
+    if (e.type != SnapshotEntry::kSymlink) continue;
+    const std::string path = dest + "/" + e.path;
+    if (symlink(e.target.c_str(), path.c_str()) != 0) {
+      *error = "cannot create " + path + ": " + std::strerror(errno);
+      return false;
+    }
+    const timespec times[2] = {Timespec(e.mtime_ns), Timespec(e.mtime_ns)};
+    utimensat(AT_FDCWD, path.c_str(), times, AT_SYMLINK_NOFOLLOW);
+  }
+  for (auto it = snap.entries.rbegin(); it != snap.entries.rend(); ++it) {
+    if (it->type != SnapshotEntry::kDirectory) continue;
+    const std::string path = dest + "/" + it->path;
+    const timespec times[2] = {Timespec(it->mtime_ns),
+                               Timespec(it->mtime_ns)};
+    chmod(path.c_str(), it->mode);
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+  }
+  return true;
+}
+
+bool ListSnapshots(const std::string& store_root,
+                   std::vector<SnapshotSummary>* snapshots,
+                   std::string* error) {
+  snapshots->clear();
+  ChunkStore store;
+  if (!store.Open(store_root, false, ChunkStore::Access::kShared, error)) {
+    return false;
+  }
+  std::vector<std::string> names;
+  std::vector<std::string> stamps;
+  if (!ListDir(store.snapshots_dir(), &names, error)) return false;
+  for (const std::string& name : names) {
+    const std::string dir = store.snapshots_dir() + "/" + name;
+    if (!ListStamps(dir, &stamps, error)) return false;
+    for (const std::string& stamp : stamps) {
+      Snapshot snap;
+      if (!ReadSnapshot(dir + "/" + stamp, &snap, error)) return false;
+      SnapshotSummary s;
+      s.id = name + "/" + stamp;
+      s.source = snap.source;
+      s.time = snap.time;
+      for (const SnapshotEntry& e : snap.entries) {
+        if (e.type != SnapshotEntry::kFile) continue;
+        s.files++;
+        s.bytes += e.size;
+      }
+      snapshots->push_back(std::move(s));
+    }
+  }
+  return true;
+}
+
+bool PruneStore(const std::string& store_root,
+                size_t keep,
+                PruneStats* stats,
+                std::string* error) {
+  *stats = PruneStats();
+  ChunkStore store;
+  // Exclusive: a running backup's new chunks are not in any manifest yet.
+  if (!store.Open(store_root, false, ChunkStore::Access::kExclusive,
+                  error)) {
+    return false;
+  }
+  std::vector<std::string> names;
+  std::vector<std::string> stamps;
+  if (!ListDir(store.snapshots_dir(), &names, error)) return false;
+
+  std::unordered_set<Sha256Digest, Sha256DigestHash> live;
+  for (const std::string& name : names) {
+    const std::string dir = store.snapshots_dir() + "/" + name;
+    if (!ListStamps(dir, &stamps, error)) return false;
+    const size_t drop =
+        keep == 0 || stamps.size() <= keep ? 0 : stamps.size() - keep;
+    for (size_t i = 0; i < stamps.size(); i++) {
+      const std::string path = dir + "/" + stamps[i];
+      if (i < drop) {
+        if (unlink(path.c_str()) != 0) {
+          *error = "cannot remove " + path + ": " + std::strerror(errno);
+          return false;
+        }
+        stats->snapshots_removed++;
+        continue;
+      }
+      Snapshot snap;
+      if (!ReadSnapshot(path, &snap, error)) return false;
+      for (const SnapshotEntry& e : snap.entries) {
+        for (const ChunkRef& c : e.chunks) live.insert(c.digest);
+      }
+    }
+  }
+
+  store.RemoveStaleTemporaries();
+  for (const Sha256Digest& digest : store.List()) {
+    if (live.count(digest) != 0) {
+      stats->chunks_kept++;
+      continue;
+    }
+    uint64_t freed = 0;
+    if (!store.Remove(digest, &freed, error)) return false;
+    stats->chunks_removed++;
+    stats->bytes_freed += freed;
+  }
+  return true;
+}
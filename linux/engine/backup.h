@@ -0,0 +1,84 @@
+#ifndef ENGINE_BACKUP_H_
+#define ENGINE_BACKUP_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+struct BackupOptions {
+  std::string store;
+  std::string source;
+  // Snapshots are grouped by name; defaults to the source's base name.
+  std::string name;
+  // zlib level for new chunks, 0 to store them uncompressed.
+  int level = 1;
+  // Read every file even when its stat matches the previous snapshot.
+  bool rescan = false;
+};
+
+struct BackupStats {
+  uint64_t files = 0;
+  // Files whose chunk list was taken from the previous snapshot unread.
+  uint64_t reused_files = 0;
+  uint64_t total_bytes = 0;
+  uint64_t scanned_bytes = 0;
+  uint64_t chunks = 0;
+  uint64_t new_chunks = 0;
+  uint64_t new_bytes = 0;
+  // Bytes written to the chunk directory after compression.
+  uint64_t stored_bytes = 0;
+};
+
+// Backs up the tree under |options.source| (work tree, .git and packfiles
+// alike) into |options.store|, creating the store on first use. Files are
+// cut into content-defined chunks; chunks the store already has are not
+// written again, and files whose size, mtime, ctime and inode match the
+// previous snapshot of the same name are not read at all. Hashing and
+// compression run on |pool|. |snapshot| receives "<name>/<timestamp>".
+// Backups into one store may run concurrently, also under the same name.
+bool RunBackup(const BackupOptions& options,
+               ThreadPool* pool,
+               std::string* snapshot,
+               BackupStats* stats,
+               std::string* error);
+
+// Recreates snapshot |snapshot| under |dest|, which must not exist or be
+// empty. Every chunk is verified against its hash.
+bool RestoreSnapshot(const std::string& store,
+                     const std::string& snapshot,
+                     const std::string& dest,
+                     ThreadPool* pool,
+                     std::string* error);
+
+struct SnapshotSummary {
+  std::string id;
+  std::string source;
+  int64_t time = 0;
+  uint64_t files = 0;
+  uint64_t bytes = 0;
+};
+
+// Every snapshot in the store, oldest first within each name.
+bool ListSnapshots(const std::string& store,
+                   std::vector<SnapshotSummary>* snapshots,
+                   std::string* error);
+
+struct PruneStats {
+  uint64_t snapshots_removed = 0;
+  uint64_t chunks_kept = 0;
+  uint64_t chunks_removed = 0;
+  uint64_t bytes_freed = 0;
+};
+
+// Deletes all but the newest |keep| snapshots of each name (none when
+// |keep| is 0), then every chunk no remaining snapshot refers to. Waits
+// for running backups and restores of the store to finish, and holds off
+// new ones until it is done.
+bool PruneStore(const std::string& store,
+                size_t keep,
+                PruneStats* stats,
+                std::string* error);
+
+#endif  // ENGINE_BACKUP_H_
@@ -0,0 +1,154 @@
+// gitgraph_backup: deduplicating snapshots of tracked repositories. Files
+// and packfiles are cut into content-defined chunks that are stored once,
+// so a nightly backup of a mostly unchanged repository writes only the
+// chunks that changed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "backup.h"
+#include "cli_args.h"
+#include "thread_pool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "usage: gitgraph_backup backup [options] <store> <repo>...\n"
+      "       gitgraph_backup restore [--threads N] <store> <snapshot> "
+      "<dest>\n"
+      "       gitgraph_backup list <store>\n"
+      "       gitgraph_backup prune [--keep N] <store>\n"
+      "  --name NAME     snapshot name (default: the repo directory's name;\n"
+      "                  one repo only)\n"
+      "  --level N       zlib level for new chunks, 0-9 (default 1)\n"
+      "  --rescan        read every file, even when unchanged since the\n"
+      "                  last snapshot\n"
+      "  --threads N     worker threads (default: all cores)\n"
+      "  --keep N        prune: snapshots to keep per name (default: all)\n");
+}
+
+double MiB(uint64_t bytes) {
+  return bytes / (1024.0 * 1024.0);
+}
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BackupOptions options;
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  int64_t keep = 0;
+  int64_t value = 0;
+  std::vector<std::string> args;
+  bool usage_error = argc < 2;
+
+  for (int i = 2; i < argc && !usage_error; i++) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--name" && has_value) {
+      options.name = argv[++i];
+    } else if (arg == "--level" && has_value) {
+      usage_error = !ParseIntArg(argv[++i], 0, 9, &value);
+      options.level = static_cast<int>(value);
+    } else if (arg == "--rescan") {
+      options.rescan = true;
+    } else if (arg == "--threads" && has_value) {
+      usage_error = !ParseIntArg(argv[++i], 1, 1024, &value);
+      threads = static_cast<size_t>(value);
+    } else if (arg == "--keep" && has_value) {
+      usage_error = !ParseIntArg(argv[++i], 1, INT64_MAX, &keep);
+    } else if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else if (!arg.empty() && arg[0] != '-') {
+      args.push_back(arg);
+    } else {
+      usage_error = true;
+    }
+  }
+  const std::string command = argc > 1 ? argv[1] : "";
+  if (command == "-h" || command == "--help") {
+    PrintUsage();
+    return 0;
+  }
+  if (usage_error ||
+      !((command == "backup" && args.size() >= 2 &&
+         (options.name.empty() || args.size() == 2)) ||
+        (command == "restore" && args.size() == 3) ||
+        ((command == "list" || command == "prune") && args.size() == 1))) {
+    PrintUsage();
+    return 2;
+  }
+
+  std::string error;
+  ThreadPool pool(threads);
+  const std::string& store = args[0];
+  if (command == "backup") {
+    options.store = store;
+    for (size_t i = 1; i < args.size(); i++) {
+      const auto start = Clock::now();
+      options.source = args[i];
+      std::string snapshot;
+      BackupStats stats;
+      if (!RunBackup(options, &pool, &snapshot, &stats, &error)) {
+        std::fprintf(stderr, "gitgraph_backup: %s\n", error.c_str());
+        return 1;
+      }
+      std::fprintf(stderr,
+                   "%s: %llu files (%.1f MiB), %llu unchanged; read %.1f MiB; "
+                   "%llu of %llu chunks new (%.1f MiB, %.1f MiB stored) "
+                   "in %.2f s\n",
+                   args[i].c_str(),
+                   static_cast<unsigned long long>(stats.files),
+                   MiB(stats.total_bytes),
+                   static_cast<unsigned long long>(stats.reused_files),
+                   MiB(stats.scanned_bytes),
+                   static_cast<unsigned long long>(stats.new_chunks),
+                   static_cast<unsigned long long>(stats.chunks),
+                   MiB(stats.new_bytes), MiB(stats.stored_bytes),
+                   SecondsSince(start));
+      std::printf("%s\n", snapshot.c_str());
+    }
+  } else if (command == "restore") {
+    if (!RestoreSnapshot(store, args[1], args[2], &pool, &error)) {
+      std::fprintf(stderr, "gitgraph_backup: %s\n", error.c_str());
+      return 1;
+    }
+  } else if (command == "list") {
+    std::vector<SnapshotSummary> snapshots;
+    if (!ListSnapshots(store, &snapshots, &error)) {
+      std::fprintf(stderr, "gitgraph_backup: %s\n", error.c_str());
+      return 1;
+    }
+    for (const SnapshotSummary& s : snapshots) {
+      std::printf("%-40s %8llu files %10.1f MiB  %s\n", s.id.c_str(),
+                  static_cast<unsigned long long>(s.files), MiB(s.bytes),
+                  s.source.c_str());
+    }
+  } else {
+    PruneStats stats;
+    if (!PruneStore(store, static_cast<size_t>(keep), &stats, &error)) {
+      std::fprintf(stderr, "gitgraph_backup: %s\n", error.c_str());
+      return 1;
+    }
+    std::fprintf(stderr,
+                 "removed %llu snapshots and %llu chunks (%.1f MiB); "
+                 "%llu chunks kept\n",
+                 static_cast<unsigned long long>(stats.snapshots_removed),
+                 static_cast<unsigned long long>(stats.chunks_removed),
+                 MiB(stats.bytes_freed),
+                 static_cast<unsigned long long>(stats.chunks_kept));
+  }
+  return 0;
+}
@@ -0,0 +1,148 @@
+#include "bloom.h"
+
+#include <unordered_set>
+
+namespace {
+
+constexpr uint32_t kSeed0 = 0x293ae76f;
+constexpr uint32_t kSeed1 = 0x7e646e2c;
+constexpr uint32_t kBitsPerWord = 8;
+
+inline uint32_t RotateLeft(uint32_t value, int count) {
+  return (value << count) | (value >> (32 - count));
+}
+
+// Version 1 widens bytes through a signed char, as git's first
+// implementation did; this only differs for paths with bytes >= 0x80.
+inline uint32_t Widen(char byte, bool sign_extend) {
+  return sign_extend
+             ? static_cast<uint32_t>(static_cast<int32_t>(
+                   static_cast<signed char>(byte)))
+             : static_cast<uint32_t>(static_cast<unsigned char>(byte));
+}
+
+uint32_t Murmur3Seeded(uint32_t seed,
+                       const char* data,
+                       size_t len,
+                       bool sign_extend) {
+  const uint32_t c1 = 0xcc9e2d51;
+  const uint32_t c2 = 0x1b873593;
+  const size_t len4 = len / 4;
+  for (size_t i = 0; i < len4; i++) {
+    uint32_t k = Widen(data[4 * i], sign_extend) |
+                 (Widen(data[4 * i + 1], sign_extend) << 8) |
+                 (Widen(data[4 * i + 2], sign_extend) << 16) |
+                 (Widen(data[4 * i + 3], sign_extend) << 24);
+    k *= c1;
+    k = RotateLeft(k, 15);
+    k *= c2;
+    seed ^= k;
+    seed = RotateLeft(seed, 13) * 5 + 0xe6546b64;
+  }
+  const char* tail = data + len4 * 4;
+  uint32_t k1 = 0;
+  switch (len & 3) {
+    case 3:
+      k1 ^= Widen(tail[2], sign_extend) << 16;
+      [[fallthrough]];
+    case 2:
+      k1 ^= Widen(tail[1], sign_extend) << 8;
+      [[fallthrough]];
+    case 1:
+      k1 ^= Widen(tail[0], sign_extend);
+      k1 *= c1;
+      k1 = RotateLeft(k1, 15);
+      k1 *= c2;
+      seed ^= k1;
+      break;
+  }
+  seed ^= static_cast<uint32_t>(len);
+  seed ^= seed >> 16;
+  seed *= 0x85ebca6b;
+  seed ^= seed >> 13;
+  seed *= 0xc2b2ae35;
+  seed ^= seed >> 16;
+  return seed;
+}
+
+void AddKey(const BloomKey& key, std::vector<uint8_t>* filter) {
+  const uint64_t mod = static_cast<uint64_t>(filter->size()) * kBitsPerWord;
+  for (uint32_t h : key.hashes) {
+    const uint64_t bit = h % mod;
+    (*filter)[bit / kBitsPerWord] |= static_cast<uint8_t>(1u << (bit % 8));
+  }
+}
+
+}  // namespace
+
+BloomKey MakeBloomKey(const std::string& path, const BloomSettings& settings) {
+  const bool sign_extend = settings.hash_version == 1;
+  const uint32_t h0 =
+      Murmur3Seeded(kSeed0, path.data(), path.size(), sign_extend);
+  const uint32_t h1 =
+      Murmur3Seeded(kSeed1, path.data(), path.size(), sign_extend);
+  BloomKey key;
+  key.hashes.resize(settings.num_hashes);
+  for (uint32_t i = 0; i < settings.num_hashes; i++) {
+    key.hashes[i] = h0 + i * h1;
+  }
+  return key;
+}
+
+std::vector<BloomKey> MakePathKeys(const std::string& path,
+                                   const BloomSettings& settings) {
+  std::vector<BloomKey> keys;
+  keys.push_back(MakeBloomKey(path, settings));
+  for (size_t slash = path.rfind('/'); slash != std::string::npos && slash > 0;
+       slash = path.rfind('/', slash - 1)) {
+    keys.push_back(MakeBloomKey(path.substr(0, slash), settings));
+  }
+  return keys;
+}
+
+BloomResult BloomContains(const uint8_t* filter,
+                          size_t len,
+                          const std::vector<BloomKey>& keys,
+                          const BloomSettings& settings) {
+  const uint64_t mod = static_cast<uint64_t>(len) * kBitsPerWord;
+  if (mod == 0) return BloomResult::kUnknown;
+  for (const auto& key : keys) {
+    for (uint32_t i = 0; i < settings.num_hashes; i++) {
+      const uint64_t bit = key.hashes[i] % mod;
+      if ((filter[bit / kBitsPerWord] & (1u << (bit % 8))) == 0) {
+        return BloomResult::kDefinitelyNot;
+      }
+    }
+  }
+  return BloomResult::kMaybe;
+}
+
+std::vector<uint8_t> BuildBloomFilter(
+    const std::vector<std::string>& changed_paths,
+    const BloomSettings& settings) {
+  if (changed_paths.size() > settings.max_changed_paths) {
+    return std::vector<uint8_t>(1, 0xff);
+  }
+  std::unordered_set<std::string> entries;
+  for (const auto& path : changed_paths) {
+    entries.insert(path);
+    for (size_t slash = path.rfind('/');
+         slash != std::string::npos && slash > 0;
+         slash = path.rfind('/', slash - 1)) {
+      entries.insert(path.substr(0, slash));
+    }
+  }
+  if (entries.size() > settings.max_changed_paths) {
+    return std::vector<uint8_t>(1, 0xff);
+  }
+  size_t len =
+      (entries.size() * settings.bits_per_entry + kBitsPerWord - 1) /
+      kBitsPerWord;
+  // An empty filter still needs one byte, or it would read as "unknown".
+  if (len == 0) len = 1;
+  std::vector<uint8_t> filter(len, 0);
+  for (const auto& entry : entries) {
+    AddKey(MakeBloomKey(entry, settings), &filter);
+  }
+  return filter;
+}
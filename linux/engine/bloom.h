@@ -0,0 +1,48 @@
+#ifndef ENGINE_BLOOM_H_
+#define ENGINE_BLOOM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Changed-path Bloom filters, bit-compatible with git's commit-graph BDAT
+// chunk (see git's bloom.c), so filters written by `git commit-graph write
+// --changed-paths` and filters built here are queried the same way.
+struct BloomSettings {
+  // Both versions hash paths with two seeded murmur3 passes. Version 1
+  // widens each path byte through a signed char, so bytes >= 0x80 are
+  // sign-extended into the hash; version 2 widens through unsigned char.
+  // They agree on ASCII paths.
+  uint32_t hash_version = 2;
+  uint32_t num_hashes = 7;
+  uint32_t bits_per_entry = 10;
+  // Commits changing more paths get a one-byte all-ones filter.
+  uint32_t max_changed_paths = 512;
+};
+
+struct BloomKey {
+  std::vector<uint32_t> hashes;
+};
+
+BloomKey MakeBloomKey(const std::string& path, const BloomSettings& settings);
+
+// Keys for |path| and each of its leading directories, which git stores
+// alongside every changed path.
+std::vector<BloomKey> MakePathKeys(const std::string& path,
+                                   const BloomSettings& settings);
+
+enum class BloomResult { kDefinitelyNot, kMaybe, kUnknown };
+
+BloomResult BloomContains(const uint8_t* filter,
+                          size_t len,
+                          const std::vector<BloomKey>& keys,
+                          const BloomSettings& settings);
+
+// Builds a filter over |changed_paths| (files only); their leading
+// directories are added automatically.
+std::vector<uint8_t> BuildBloomFilter(
+    const std::vector<std::string>& changed_paths,
+    const BloomSettings& settings);
+
+#endif  // ENGINE_BLOOM_H_
@@ -0,0 +1,300 @@
+#include "change_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+#include "json_writer.h"
+#include "object_reader.h"
+#include "repo_state.h"
+#include "thread_pool.h"
+#include "tree_diff.h"
+
+namespace {
+
+constexpr size_t kBinaryProbeBytes = 8000;
+// Beyond this many edits Myers gets quadratic; fall back to counting lines
+// that only occur on one side, which agrees with Myers for typical rewrites.
+constexpr size_t kMaxEditDistance = 4096;
+constexpr uint32_t kGitlinkMode = 0160000;
+
+const Oid kEmptyTreeKey{};
+
+std::vector<uint64_t> HashLines(const std::string& text) {
+  std::vector<uint64_t> lines;
+  uint64_t h = 1469598103934665603ull;
+  bool open = false;
+  for (char c : text) {
+    if (c == '\n') {
+      lines.push_back(h);
+      h = 1469598103934665603ull;
+      open = false;
+      continue;
+    }
+    h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    open = true;
+  }
+  // A final line without a newline still counts, but never matches the same
+  // text with one (git's "No newline at end of file").
+  if (open) lines.push_back(~h);
+  return lines;
+}
+
+// Length of the shortest edit script (insertions + deletions) between a and
+// b, or SIZE_MAX if it exceeds kMaxEditDistance.
+size_t MyersDistance(const uint64_t* a, size_t n, const uint64_t* b, size_t m) {
+  const size_t max_d = std::min(n + m, kMaxEditDistance);
+  const ptrdiff_t offset = static_cast<ptrdiff_t>(max_d) + 1;
+  std::vector<ptrdiff_t> v(2 * max_d + 3, 0);
+  for (size_t d = 0; d <= max_d; d++) {
+    const ptrdiff_t dd = static_cast<ptrdiff_t>(d);
+    for (ptrdiff_t k = -dd; k <= dd; k += 2) {
+      ptrdiff_t x;
+      if (k == -dd || (k != dd && v[offset + k - 1] < v[offset + k + 1])) {
+        x = v[offset + k + 1];
+      } else {
+        x = v[offset + k - 1] + 1;
+      }
+      ptrdiff_t y = x - k;
+      while (x < static_cast<ptrdiff_t>(n) && y < static_cast<ptrdiff_t>(m) &&
+             a[x] == b[y]) {
+        x++;
+        y++;
+      }
+      v[offset + k] = x;
+      if (x >= static_cast<ptrdiff_t>(n) && y >= static_cast<ptrdiff_t>(m)) {
+        return d;
+      }
+    }
+  }
+  return SIZE_MAX;
+}
+
+size_t CountLines(const std::string& text) {
+  return HashLines(text).size();
+}
+
+// Git pairs a deleted and an added path with the same blob as a rename
+// without looking at their contents; a file and a symlink never pair.
+bool IsExactRename(const TreeEntry& deleted, const TreeEntry& added) {
+  return deleted.oid == added.oid && deleted.mode != kGitlinkMode &&
+         added.mode != 0 &&
+         (deleted.mode & 0170000) == (added.mode & 0170000);
+}
+
+}  // namespace
+
+bool ChangeStatsCache::Lookup(const Oid& tree,
+                              const Oid& parent_tree,
+                              ChangeStats* out) const {
+  Shard& shard = ShardFor(tree);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.map.find(Key{tree, parent_tree});
+  if (it == shard.map.end()) return false;
+  *out = it->second;
+  return true;
+}
+
+void ChangeStatsCache::Insert(const Oid& tree,
+                              const Oid& parent_tree,
+                              const ChangeStats& stats) {
+  Shard& shard = ShardFor(tree);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.map[Key{tree, parent_tree}] = stats;
+}
+
+bool LooksBinary(const std::string& data) {
+  const size_t n = std::min(data.size(), kBinaryProbeBytes);
+  return std::memchr(data.data(), '\0', n) != nullptr;
+}
+
+void CountLineChanges(const std::string& old_text,
+                      const std::string& new_text,
+                      uint64_t* added,
+                      uint64_t* removed) {
+  const std::vector<uint64_t> a = HashLines(old_text);
+  const std::vector<uint64_t> b = HashLines(new_text);
+  size_t prefix = 0;
+  while (prefix < a.size() && prefix < b.size() && a[prefix] == b[prefix]) {
+    prefix++;
+  }
+  size_t suffix = 0;
+  while (suffix < a.size() - prefix && suffix < b.size() - prefix &&
+         a[a.size() - 1 - suffix] == b[b.size() - 1 - suffix]) {
+    suffix++;
+  }
+  const size_t n = a.size() - prefix - suffix;
+  const size_t m = b.size() - prefix - suffix;
+  const size_t d = MyersDistance(a.data() + prefix, n, b.data() + prefix, m);
+  if (d != SIZE_MAX) {
+    // d = n + m - 2 * lcs.
+    const size_t lcs = (n + m - d) / 2;
+    *added += m - lcs;
+    *removed += n - lcs;
+    return;
+  }
+  std::unordered_map<uint64_t, ptrdiff_t> balance;
+  for (size_t i = prefix; i < prefix + n; i++) balance[a[i]]++;
+  for (size_t i = prefix; i < prefix + m; i++) balance[b[i]]--;
+  for (const auto& e : balance) {
+    if (e.second > 0) *removed += e.second;
+    if (e.second < 0) *added += -e.second;
+  }
+}
+
+std::string CommitStatsJson(RepoState* repo,
+                            const std::vector<std::string>& commit_ids) {
+  const CommitLog& log = repo->log;
+  std::vector<uint32_t> rows;
+  std::vector<std::string> missing;
+  for (const auto& id : commit_ids) {
+    const uint32_t row = log.Find(id);
+    if (row == kNoCommit) {
+      missing.push_back(id);
+    } else {
+      rows.push_back(row);
+    }
+  }
+
+  ThreadPool& pool = ThreadPool::Shared();
+  std::vector<std::unique_ptr<ObjectReader>> readers(pool.size());
+  std::vector<std::string> errors(pool.size());
+  std::vector<ChangeStats> results(rows.size());
+  std::atomic<size_t> cache_hits{0};
+
+  pool.ParallelFor(rows.size(), [&](size_t i, size_t worker) {
+    if (!errors[worker].empty()) return;
+    const uint32_t row = rows[i];
+    const RowSpan parents = log.parents(row);
+    Oid tree;
+    Oid parent_tree = kEmptyTreeKey;
+    const bool has_parent = !parents.empty() && parents[0] != kNoCommit;
+    if (!log.GetTree(row, &tree) ||
+        (has_parent && !log.GetTree(parents[0], &parent_tree))) {
+      errors[worker] = "unsupported object id in " + log.id(row);
+      return;
+    }
+    if (repo->stats_cache.Lookup(tree, parent_tree, &results[i])) {
+      cache_hits++;
+      return;
+    }
+    auto& reader = readers[worker];
+    if (!reader) reader.reset(new ObjectReader(repo->path));
+    if (!reader->ok()) {
+      errors[worker] = reader->error();
+      return;
+    }
+
+    ChangeStats stats;
+    bool read_ok = true;
+    std::string type, old_blob, new_blob;
+    auto read_blob = [&](const TreeEntry* e, std::string* out) {
+      out->clear();
+      if (e == nullptr || e->mode == kGitlinkMode) return;
+      if (!reader->Read(e->oid, &type, out)) read_ok = false;
+    };
+    auto count = [&](const TreeEntry* a, const TreeEntry* b) {
+      stats.files++;
+      read_blob(a, &old_blob);
+      read_blob(b, &new_blob);
+      if (LooksBinary(old_blob) || LooksBinary(new_blob)) {
+        stats.binary_files++;
+      } else if (a == nullptr) {
+        stats.added += CountLines(new_blob);
+      } else if (b == nullptr) {
+        stats.removed += CountLines(old_blob);
+      } else {
+        CountLineChanges(old_blob, new_blob, &stats.added, &stats.removed);
+      }
+    };
+    // Additions and deletions wait until the walk is done, so that exact
+    // renames can be paired first.
+    std::vector<TreeEntry> deleted, added;
+    const bool diff_ok = DiffTrees(
+        reader.get(), has_parent ? &parent_tree : nullptr, &tree,
+        [&](const std::string&, const TreeEntry* a, const TreeEntry* b) {
+          if (a == nullptr) {
+            added.push_back(*b);
+          } else if (b == nullptr) {
+            deleted.push_back(*a);
+          } else {
+            count(a, b);
+          }
+        });
+    std::unordered_multimap<Oid, size_t, OidHash> added_by_oid;
+    if (!deleted.empty()) {
+      for (size_t k = 0; k < added.size(); k++) {
+        added_by_oid.emplace(added[k].oid, k);
+      }
+    }
+    for (const TreeEntry& d : deleted) {
+      TreeEntry* pair = nullptr;
+      for (auto range = added_by_oid.equal_range(d.oid);
+           range.first != range.second && pair == nullptr; ++range.first) {
+        TreeEntry& e = added[range.first->second];
+        if (IsExactRename(d, e)) pair = &e;
+      }
+      if (pair == nullptr) {
+        count(&d, nullptr);
+        continue;
+      }
+      // A rename without content changes: one file, no lines.
+      stats.files++;
+      read_blob(&d, &old_blob);
+      if (LooksBinary(old_blob)) stats.binary_files++;
+      // No real entry has mode 0, so this marks the addition as claimed.
+      pair->mode = 0;
+    }
+    for (const TreeEntry& e : added) {
+      if (e.mode != 0) count(nullptr, &e);
+    }
+    if (!diff_ok || !read_ok) {
+      errors[worker] = reader->error().empty()
+                           ? "cannot diff " + log.id(row)
+                           : reader->error();
+      return;
+    }
+    repo->stats_cache.Insert(tree, parent_tree, stats);
+    results[i] = stats;
+  });
+
+  for (const auto& e : errors) {
+    if (!e.empty()) return JsonError(e);
+  }
+
+  ChangeStats totals;
+  JsonWriter w;
+  w.BeginObject();
+  w.Key("stats").BeginArray();
+  for (size_t i = 0; i < rows.size(); i++) {
+    const ChangeStats& s = results[i];
+    totals.files += s.files;
+    totals.binary_files += s.binary_files;
+    totals.added += s.added;
+    totals.removed += s.removed;
+    w.BeginObject();
+    w.Key("id").String(log.id(rows[i]));
+    w.Key("files").Int(s.files);
+    w.Key("binaryFiles").Int(s.binary_files);
+    w.Key("added").Int(static_cast<int64_t>(s.added));
+    w.Key("removed").Int(static_cast<int64_t>(s.removed));
+    w.EndObject();
+  }
+  w.EndArray();
+  w.Key("totals").BeginObject();
+  w.Key("commits").Int(static_cast<int64_t>(rows.size()));
+  w.Key("files").Int(totals.files);
+  w.Key("binaryFiles").Int(totals.binary_files);
+  w.Key("added").Int(static_cast<int64_t>(totals.added));
+  w.Key("removed").Int(static_cast<int64_t>(totals.removed));
+  w.EndObject();
+  w.Key("missing").BeginArray();
+  for (const auto& id : missing) w.String(id);
+  w.EndArray();
+  w.Key("cached").Int(static_cast<int64_t>(cache_hits.load()));
+  w.Key("threads").Int(static_cast<int64_t>(pool.size()));
+  w.EndObject();
+  return w.Take();
+}
@@ -0,0 +1,77 @@
+#ifndef ENGINE_CHANGE_STATS_H_
+#define ENGINE_CHANGE_STATS_H_
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "oid.h"
+
+struct RepoState;
+
+// `git diff --numstat` totals for one commit against its first parent.
+// Binary files count towards |files| but not towards the line totals.
+// Renames are paired only when the blob is unchanged (git's exact rename
+// detection); a rename with edits counts as a deletion plus an addition,
+// where git's similarity detection would report one file.
+struct ChangeStats {
+  uint32_t files = 0;
+  uint32_t binary_files = 0;
+  uint64_t added = 0;
+  uint64_t removed = 0;
+};
+
+// Stats keyed by (tree, parent tree) rather than by commit, so rebased or
+// cherry-picked commits with identical trees share one entry. Sharded so
+// pool workers rarely wait on each other.
+class ChangeStatsCache {
+ public:
+  bool Lookup(const Oid& tree, const Oid& parent_tree, ChangeStats* out) const;
+  void Insert(const Oid& tree, const Oid& parent_tree, const ChangeStats& stats);
+
+ private:
+  struct Key {
+    Oid tree;
+    Oid parent_tree;
+    bool operator==(const Key& o) const {
+      return tree == o.tree && parent_tree == o.parent_tree;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key& k) const {
+      return OidHash()(k.tree) * 31 + OidHash()(k.parent_tree);
+    }
+  };
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<Key, ChangeStats, KeyHash> map;
+  };
+  static constexpr size_t kShards = 32;
+
+  Shard& ShardFor(const Oid& tree) const {
+    return shards_[tree[0] % kShards];
+  }
+
+  mutable std::array<Shard, kShards> shards_;
+};
+
+// Git's binary heuristic: a NUL byte within the first 8000 bytes.
+bool LooksBinary(const std::string& data);
+
+// Lines added and removed between two texts, from a minimal line diff as
+// numstat reports them. Past 4096 edits the counts come from lines unique
+// to either side, which can differ from git's.
+void CountLineChanges(const std::string& old_text,
+                      const std::string& new_text,
+                      uint64_t* added,
+                      uint64_t* removed);
+
+// Diffs every listed commit against its first parent on the shared thread
+// pool and returns per-commit stats plus their totals.
+std::string CommitStatsJson(RepoState* repo,
+                            const std::vector<std::string>& commit_ids);
+
+#endif  // ENGINE_CHANGE_STATS_H_
@@ -0,0 +1,374 @@
+#include "changed_path_index.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "git_process.h"
+#include "object_reader.h"
+#include "tree_diff.h"
+
+namespace {
+
+constexpr char kEngineMagic[4] = {'G', 'G', 'B', 'F'};
+constexpr uint32_t kEngineVersion = 1;
+constexpr size_t kEngineHeaderSize = 24;
+constexpr uint32_t kChunkOidFanout = 0x4f494446;  // "OIDF"
+constexpr uint32_t kChunkOidLookup = 0x4f49444c;  // "OIDL"
+constexpr uint32_t kChunkBloomIndexes = 0x42494458;  // "BIDX"
+constexpr uint32_t kChunkBloomData = 0x42444154;  // "BDAT"
+constexpr size_t kBloomDataHeaderSize = 12;
+
+uint32_t ReadBE32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t ReadBE64(const uint8_t* p) {
+  return (static_cast<uint64_t>(ReadBE32(p)) << 32) | ReadBE32(p + 4);
+}
+
+uint32_t ReadLE32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void AppendLE32(std::vector<uint8_t>* out, uint32_t v) {
+  for (int i = 0; i < 4; i++) out->push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+bool ReadFile(const std::string& path, std::vector<uint8_t>* bytes) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  bytes->assign(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+  return true;
+}
+
+// Binary search over rows [lo, hi) of a sorted table of raw oids. Returns
+// |hi| if |oid| is absent.
+uint32_t FindOid(const uint8_t* table,
+                 uint32_t lo,
+                 uint32_t hi,
+                 const Oid& oid) {
+  const uint32_t end = hi;
+  while (lo < hi) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    const int c = std::memcmp(table + size_t{mid} * kOidSize, oid.data(),
+                              kOidSize);
+    if (c == 0) return mid;
+    if (c < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return end;
+}
+
+bool ResolveCommonDir(const std::string& repo_path,
+                      std::string* common_dir,
+                      std::string* error) {
+  std::vector<std::string> lines;
+  if (!RunGitLines(repo_path, {"rev-parse", "--git-common-dir"}, &lines,
+                   error) ||
+      lines.empty()) {
+    if (error->empty()) *error = "cannot locate git directory";
+    return false;
+  }
+  *common_dir = lines[0];
+  if (common_dir->empty() || (*common_dir)[0] != '/') {
+    *common_dir = repo_path + "/" + *common_dir;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<ChangedPathIndex> ChangedPathIndex::Open(
+    const std::string& repo_path,
+    const CommitLog& log,
+    std::string* error) {
+  std::unique_ptr<ChangedPathIndex> index(new ChangedPathIndex());
+  index->filters_.resize(log.size());
+  std::string common_dir;
+  if (!ResolveCommonDir(repo_path, &common_dir, error)) return nullptr;
+  index->LoadCommitGraphs(common_dir + "/objects", log);
+
+  const std::string engine_file = common_dir + "/gitgraph/changed-paths.bloom";
+  index->LoadEngineFile(engine_file, log);
+  if (!index->ComputeMissing(repo_path, log, engine_file, error)) {
+    return nullptr;
+  }
+  return index;
+}
+
+BloomResult ChangedPathIndex::Check(uint32_t row, Query* query) const {
+  const FilterRef& ref = filters_[row];
+  if (ref.source < 0) return BloomResult::kUnknown;
+  if (query->keys_.size() < sources_.size()) query->keys_.resize(sources_.size());
+  auto& keys = query->keys_[ref.source];
+  const Source& source = sources_[ref.source];
+  if (keys.empty()) keys = MakePathKeys(query->path_, source.settings);
+  return BloomContains(source.bytes.data() + ref.offset, ref.length, keys,
+                       source.settings);
+}
+
+bool ChangedPathIndex::LoadCommitGraphs(const std::string& objects_dir,
+                                        const CommitLog& log) {
+  bool any = LoadCommitGraphFile(objects_dir + "/info/commit-graph", log);
+  const std::string chain_dir = objects_dir + "/info/commit-graphs";
+  std::ifstream chain(chain_dir + "/commit-graph-chain");
+  std::string hash;
+  while (std::getline(chain, hash)) {
+    if (hash.empty()) continue;
+    any |= LoadCommitGraphFile(chain_dir + "/graph-" + hash + ".graph", log);
+  }
+  return any;
+}
+
+bool ChangedPathIndex::LoadCommitGraphFile(const std::string& file,
+                                           const CommitLog& log) {
+  Source source;
+  if (!ReadFile(file, &source.bytes)) return false;
+  const std::vector<uint8_t>& b = source.bytes;
+  // Header: "CGPH", version, hash version (1 = SHA-1), chunk count, bases.
+  if (b.size() < 8 || std::memcmp(b.data(), "CGPH", 4) != 0 || b[4] != 1 ||
+      b[5] != 1) {
+    return false;
+  }
+  const uint32_t num_chunks = b[6];
+  if (b.size() < 8 + (num_chunks + 1) * 12) return false;
+  // Each chunk runs up to the offset in the next table-of-contents entry.
+  uint64_t fanout = 0, lookup = 0, bidx = 0, bdat = 0;
+  uint64_t fanout_end = 0, lookup_end = 0, bidx_end = 0, bdat_end = 0;
+  for (uint32_t i = 0; i < num_chunks; i++) {
+    const uint8_t* entry = b.data() + 8 + i * 12;
+    const uint32_t id = ReadBE32(entry);
+    const uint64_t offset = ReadBE64(entry + 4);
+    const uint64_t next = ReadBE64(entry + 16);
+    if (offset > b.size() || next > b.size() || next < offset) return false;
+    if (id == kChunkOidFanout) {
+      fanout = offset;
+      fanout_end = next;
+    }
+    if (id == kChunkOidLookup) {
+      lookup = offset;
+      lookup_end = next;
+    }
+    if (id == kChunkBloomIndexes) {
+      bidx = offset;
+      bidx_end = next;
+    }
+    if (id == kChunkBloomData) {
+      bdat = offset;
+      bdat_end = next;
+    }
+  }
+  // Graphs written without --changed-paths have no Bloom chunks.
+  if (fanout == 0 || lookup == 0 || bidx == 0 || bdat == 0 ||
+      bdat_end - bdat < kBloomDataHeaderSize) {
+    return false;
+  }
+  // Every read below stays inside these chunks only if their sizes agree
+  // with the commit count the fanout declares.
+  if (fanout_end - fanout != 256 * 4) return false;
+  const uint32_t count = ReadBE32(b.data() + fanout + 255 * 4);
+  if (lookup_end - lookup != uint64_t{count} * kOidSize ||
+      bidx_end - bidx != uint64_t{count} * 4) {
+    return false;
+  }
+  source.settings.hash_version = ReadBE32(b.data() + bdat);
+  source.settings.num_hashes = ReadBE32(b.data() + bdat + 4);
+  source.settings.bits_per_entry = ReadBE32(b.data() + bdat + 8);
+  if (source.settings.hash_version != 1 && source.settings.hash_version != 2) {
+    return false;
+  }
+  const uint64_t data_start = bdat + kBloomDataHeaderSize;
+
+  const int32_t source_index = static_cast<int32_t>(sources_.size());
+  size_t covered = 0;
+  Oid oid;
+  for (uint32_t row = 0; row < log.size(); row++) {
+    if (filters_[row].source >= 0) continue;
+    if (!log.GetOid(row, &oid)) continue;
+    const uint32_t lo = oid[0] == 0 ? 0 : ReadBE32(b.data() + fanout +
+                                                   (oid[0] - 1) * 4);
+    const uint32_t hi = ReadBE32(b.data() + fanout + oid[0] * 4);
+    if (lo > hi || hi > count) continue;
+    const uint32_t pos = FindOid(b.data() + lookup, lo, hi, oid);
+    if (pos == hi) continue;
+    const uint32_t begin = pos == 0 ? 0 : ReadBE32(b.data() + bidx + (pos - 1) * 4);
+    const uint32_t end = ReadBE32(b.data() + bidx + pos * 4);
+    if (end < begin || data_start + end > bdat_end) continue;
+    filters_[row].source = source_index;
+    filters_[row].offset = static_cast<uint32_t>(data_start + begin);
+    filters_[row].length = end - begin;
+    covered++;
+  }
+  if (covered == 0) return false;
+  commit_graph_filters_ += covered;
+  sources_.push_back(std::move(source));
+  return true;
+}
+
+bool ChangedPathIndex::LoadEngineFile(const std::string& file,
+                                      const CommitLog& log) {
+  std::vector<uint8_t> bytes;
+  if (!ReadFile(file, &bytes)) return false;
+  return LoadEngineBytes(std::move(bytes), log);
+}
+
+bool ChangedPathIndex::LoadEngineBytes(std::vector<uint8_t> bytes,
+                                       const CommitLog& log) {
+  Source source;
+  source.bytes = std::move(bytes);
+  const std::vector<uint8_t>& b = source.bytes;
+  if (b.size() < kEngineHeaderSize ||
+      std::memcmp(b.data(), kEngineMagic, 4) != 0 ||
+      ReadLE32(b.data() + 4) != kEngineVersion) {
+    return false;
+  }
+  source.settings.hash_version = ReadLE32(b.data() + 8);
+  source.settings.num_hashes = ReadLE32(b.data() + 12);
+  source.settings.bits_per_entry = ReadLE32(b.data() + 16);
+  const uint32_t count = ReadLE32(b.data() + 20);
+  const uint64_t oids = kEngineHeaderSize;
+  const uint64_t ends = oids + uint64_t{count} * kOidSize;
+  const uint64_t data_start = ends + uint64_t{count} * 4;
+  if (data_start > b.size()) return false;
+
+  const int32_t source_index = static_cast<int32_t>(sources_.size());
+  size_t covered = 0;
+  Oid oid;
+  for (uint32_t row = 0; row < log.size(); row++) {
+    if (filters_[row].source >= 0) continue;
+    if (!log.GetOid(row, &oid)) continue;
+    const uint32_t pos = FindOid(b.data() + oids, 0, count, oid);
+    if (pos == count) continue;
+    const uint32_t begin = pos == 0 ? 0 : ReadLE32(b.data() + ends + (pos - 1) * 4);
+    const uint32_t end = ReadLE32(b.data() + ends + pos * 4);
+    if (end < begin || data_start + end > b.size()) continue;
+    filters_[row].source = source_index;
+    filters_[row].offset = static_cast<uint32_t>(data_start + begin);
+    filters_[row].length = end - begin;
+    covered++;
+  }
+  engine_filters_ = covered;
+  source.engine = true;
+  sources_.push_back(std::move(source));
+  return true;
+}
+
+bool ChangedPathIndex::ComputeMissing(const std::string& repo_path,
+                                      const CommitLog& log,
+                                      const std::string& file,
+                                      std::string* error) {
+  // Merges are always verified against every parent, so they need no filter.
+  std::vector<uint32_t> missing;
+  for (uint32_t row = 0; row < log.size(); row++) {
+    if (filters_[row].source < 0 && log.parents(row).size() <= 1) {
+      missing.push_back(row);
+    }
+  }
+  if (missing.empty()) return true;
+
+  const BloomSettings settings;
+  std::vector<std::pair<Oid, std::vector<uint8_t>>> entries;
+  // Carry over the filters this load used from the previous engine file.
+  // Entries for commits no longer in the history, or now covered by the
+  // commit-graph, are dropped so the file does not grow without bound.
+  int32_t old_source = -1;
+  for (size_t s = 0; s < sources_.size(); s++) {
+    if (sources_[s].engine) old_source = static_cast<int32_t>(s);
+  }
+  if (old_source >= 0) {
+    const std::vector<uint8_t>& b = sources_[old_source].bytes;
+    for (uint32_t row = 0; row < log.size(); row++) {
+      const FilterRef& f = filters_[row];
+      Oid oid;
+      if (f.source != old_source || !log.GetOid(row, &oid)) continue;
+      entries.emplace_back(
+          oid, std::vector<uint8_t>(b.begin() + f.offset,
+                                    b.begin() + f.offset + f.length));
+    }
+  }
+
+  ObjectReader reader(repo_path);
+  if (!reader.ok()) {
+    *error = reader.error();
+    return false;
+  }
+  std::vector<std::string> paths;
+  for (uint32_t row : missing) {
+    const RowSpan parents = log.parents(row);
+    Oid oid, tree, parent_tree;
+    const bool has_parent = !parents.empty() && parents[0] != kNoCommit;
+    if (!log.GetOid(row, &oid) || !log.GetTree(row, &tree) ||
+        (has_parent && !log.GetTree(parents[0], &parent_tree))) {
+      *error = "unsupported object id in " + log.id(row);
+      return false;
+    }
+    paths.clear();
+    const bool ok = DiffTrees(
+        &reader, has_parent ? &parent_tree : nullptr, &tree,
+        [&paths](const std::string& path, const TreeEntry*, const TreeEntry*) {
+          paths.push_back(path);
+        });
+    if (!ok) {
+      *error = reader.error().empty() ? "cannot diff " + log.id(row)
+                                      : reader.error();
+      return false;
+    }
+    entries.emplace_back(oid, BuildBloomFilter(paths, settings));
+  }
+  computed_filters_ = missing.size();
+
+  std::sort(entries.begin(), entries.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  std::vector<uint8_t> bytes(kEngineMagic, kEngineMagic + 4);
+  AppendLE32(&bytes, kEngineVersion);
+  AppendLE32(&bytes, settings.hash_version);
+  AppendLE32(&bytes, settings.num_hashes);
+  AppendLE32(&bytes, settings.bits_per_entry);
+  AppendLE32(&bytes, static_cast<uint32_t>(entries.size()));
+  for (const auto& e : entries) bytes.insert(bytes.end(), e.first.begin(), e.first.end());
+  uint32_t end = 0;
+  for (const auto& e : entries) {
+    end += static_cast<uint32_t>(e.second.size());
+    AppendLE32(&bytes, end);
+  }
+  for (const auto& e : entries) bytes.insert(bytes.end(), e.second.begin(), e.second.end());
+
+  // Persisting is best effort: a read-only repository still gets filters for
+  // this session.
+  const std::string dir = file.substr(0, file.rfind('/'));
+  mkdir(dir.c_str(), 0755);
+  const std::string tmp = file + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+  }
+  std::rename(tmp.c_str(), file.c_str());
+
+  if (old_source >= 0) {
+    for (auto& f : filters_) {
+      if (f.source == old_source) f.source = -1;
+    }
+    sources_[old_source].bytes.clear();
+    sources_[old_source].engine = false;
+  }
+  // The reloaded file also holds the filters computed above; only the ones
+  // reused from disk count as engine filters.
+  const size_t reused = engine_filters_;
+  LoadEngineBytes(std::move(bytes), log);
+  engine_filters_ = reused;
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef ENGINE_CHANGED_PATH_INDEX_H_
+#define ENGINE_CHANGED_PATH_INDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bloom.h"
+#include "commit_log.h"
+
+// Per-commit changed-path Bloom filters for one loaded history.
+//
+// Filters come from git's commit-graph (BIDX/BDAT chunks, including split
+// chains) when present. Non-merge commits the commit-graph does not cover get
+// a filter computed from a first-parent tree diff; those are persisted to
+// <git-common-dir>/gitgraph/changed-paths.bloom and reused on the next load.
+class ChangedPathIndex {
+ public:
+  // Filters for one path query, with keys hashed per filter source.
+  class Query {
+   public:
+    explicit Query(const std::string& path) : path_(path) {}
+    const std::string& path() const { return path_; }
+
+   private:
+    friend class ChangedPathIndex;
+    std::string path_;
+    std::vector<std::vector<BloomKey>> keys_;
+  };
+
+  static std::unique_ptr<ChangedPathIndex> Open(const std::string& repo_path,
+                                                const CommitLog& log,
+                                                std::string* error);
+
+  // kDefinitelyNot means |row| did not change the query path relative to its
+  // first parent. Merges and uncovered commits report kUnknown.
+  BloomResult Check(uint32_t row, Query* query) const;
+
+  size_t commit_graph_filters() const { return commit_graph_filters_; }
+  size_t engine_filters() const { return engine_filters_; }
+  size_t computed_filters() const { return computed_filters_; }
+
+ private:
+  struct Source {
+    BloomSettings settings;
+    // Backing bytes: a whole commit-graph file or the engine filter file.
+    std::vector<uint8_t> bytes;
+    bool engine = false;
+  };
+  struct FilterRef {
+    int32_t source = -1;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+  };
+
+  bool LoadCommitGraphs(const std::string& objects_dir, const CommitLog& log);
+  bool LoadCommitGraphFile(const std::string& file, const CommitLog& log);
+  bool LoadEngineFile(const std::string& file, const CommitLog& log);
+  bool LoadEngineBytes(std::vector<uint8_t> bytes, const CommitLog& log);
+  bool ComputeMissing(const std::string& repo_path,
+                      const CommitLog& log,
+                      const std::string& file,
+                      std::string* error);
+
+  std::vector<Source> sources_;
+  std::vector<FilterRef> filters_;
+  size_t commit_graph_filters_ = 0;
+  size_t engine_filters_ = 0;
+  size_t computed_filters_ = 0;
+};
+
+#endif  // ENGINE_CHANGED_PATH_INDEX_H_
@@ -0,0 +1,377 @@
+#include "chunk_store.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include "oid.h"
+
+namespace {
+
+constexpr char kMarker[] = "gitgraph-backup-store 1\n";
+constexpr uint8_t kStored = 0;
+constexpr uint8_t kDeflated = 1;
+// Chunks are deflated only when a sample of this many bytes shrinks to at
+// most 7/8. Packfiles and loose objects are deflated already, and running
+// zlib over them again costs most of a first backup's CPU for a few
+// percent.
+constexpr size_t kSampleSize = 8 * 1024;
+
+std::atomic<uint64_t> g_temp_counter{0};
+
+bool ReadFile(const std::string& path, std::vector<uint8_t>* out) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  if (ok) {
+    out->resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (ok && done < out->size()) {
+      const ssize_t n = read(fd, out->data() + done, out->size() - done);
+      if (n < 0 && errno == EINTR) continue;
+      ok = n > 0;
+      if (ok) done += static_cast<size_t>(n);
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    const ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// fsync on a directory makes the names renamed or created in it durable.
+bool SyncDir(const std::string& path, std::string* error) {
+  const int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  const bool ok = fd >= 0 && fsync(fd) == 0;
+  if (!ok) *error = "cannot sync " + path + ": " + std::strerror(errno);
+  if (fd >= 0) close(fd);
+  return ok;
+}
+
+bool MakeDir(const std::string& path, std::string* error) {
+  if (mkdir(path.c_str(), 0755) == 0 || errno == EEXIST) return true;
+  *error = "cannot create " + path + ": " + std::strerror(errno);
+  return false;
+}
+
+}  // namespace
+
+ChunkStore::~ChunkStore() {
+  if (lock_fd_ >= 0) close(lock_fd_);
+}
+
+bool ChunkStore::Open(const std::string& root,
+                      bool create,
+                      Access access,
+                      std::string* error) {
+  if (lock_fd_ >= 0) close(lock_fd_);
+  lock_fd_ = -1;
+  root_ = root;
+  while (root_.size() > 1 && root_.back() == '/') root_.pop_back();
+  const std::string marker_path = root_ + "/store";
+  std::vector<uint8_t> marker;
+  if (!ReadFile(marker_path, &marker)) {
+    if (!create) {
+      *error = root_ + " is not a backup store";
+      return false;
+    }
+    if (!Create(error)) return false;
+    if (!ReadFile(marker_path, &marker)) {
+      *error = "cannot read " + marker_path + ": " + std::strerror(errno);
+      return false;
+    }
+  }
+  if (std::string(marker.begin(), marker.end()) != kMarker) {
+    *error = "unsupported backup store format in " + root_;
+    return false;
+  }
+  if (!Lock(access, error)) return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  chunks_.clear();
+  Sha256Digest digest;
+  for (int i = 0; i < 256; i++) {
+    digest[0] = static_cast<uint8_t>(i);
+    const std::string dir = root_ + "/chunks/" + HexEncode(&digest[0], 1);
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) {
+      *error = "cannot read " + dir + ": " + std::strerror(errno);
+      return false;
+    }
+    while (dirent* e = readdir(d)) {
+      if (std::strlen(e->d_name) == 2 * (digest.size() - 1) &&
+          ParseHex(e->d_name, 2 * (digest.size() - 1), &digest[1])) {
+        chunks_.insert(digest);
+      }
+    }
+    closedir(d);
+  }
+  return true;
+}
+
+bool ChunkStore::Create(std::string* error) {
+  // Two backups may both find no store. They take turns on the parent
+  // directory, and the second one finds the first one's marker.
+  const size_t slash = root_.rfind('/');
+  std::string parent = ".";
+  if (slash != std::string::npos) parent = root_.substr(0, slash ? slash : 1);
+  const int parent_fd =
+      open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (parent_fd < 0) {
+    *error = "cannot create " + root_ + ": " + std::strerror(errno);
+    return false;
+  }
+  while (flock(parent_fd, LOCK_EX) != 0 && errno == EINTR) {
+  }
+  const bool ok = CreateLocked(error);
+  close(parent_fd);
+  return ok;
+}
+
+bool ChunkStore::CreateLocked(std::string* error) {
+  const std::string marker_path = root_ + "/store";
+  if (access(marker_path.c_str(), F_OK) == 0) return true;
+  DIR* existing = opendir(root_.c_str());
+  if (existing != nullptr) {
+    bool empty = true;
+    while (dirent* e = readdir(existing)) {
+      if (std::strcmp(e->d_name, ".") != 0 &&
+          std::strcmp(e->d_name, "..") != 0) {
+        empty = false;
+      }
+    }
+    closedir(existing);
+    if (!empty) {
+      *error = root_ + " exists and is not a backup store";
+      return false;
+    }
+  }
+  if (!MakeDir(root_, error) || !MakeDir(root_ + "/chunks", error) ||
+      !MakeDir(snapshots_dir(), error)) {
+    return false;
+  }
+  for (int i = 0; i < 256; i++) {
+    const uint8_t byte = static_cast<uint8_t>(i);
+    if (!MakeDir(root_ + "/chunks/" + HexEncode(&byte, 1), error)) {
+      return false;
+    }
+  }
+  const int fd = open(marker_path.c_str(),
+                      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  const bool ok =
+      fd >= 0 && WriteAll(fd, reinterpret_cast<const uint8_t*>(kMarker),
+                          sizeof(kMarker) - 1);
+  if (fd >= 0) close(fd);
+  if (!ok) {
+    *error = "cannot write " + marker_path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool ChunkStore::Lock(Access access, std::string* error) {
+  const std::string path = root_ + "/lock";
+  lock_fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (lock_fd_ < 0) {
+    *error = "cannot open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  const int op = access == Access::kExclusive ? LOCK_EX : LOCK_SH;
+  int rc;
+  do {
+    rc = flock(lock_fd_, op);
+  } while (rc != 0 && errno == EINTR);
+  if (rc != 0) {
+    *error = "cannot lock " + path + ": " + std::strerror(errno);
+    close(lock_fd_);
+    lock_fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+std::string ChunkStore::ChunkPath(const Sha256Digest& digest) const {
+  return root_ + "/chunks/" + HexEncode(digest.data(), 1) + "/" +
+         HexEncode(digest.data() + 1, digest.size() - 1);
+}
+
+bool ChunkStore::Contains(const Sha256Digest& digest) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return chunks_.count(digest) != 0;
+}
+
+size_t ChunkStore::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return chunks_.size();
+}
+
+bool ChunkStore::Put(const Sha256Digest& digest,
+                     const uint8_t* data,
+                     size_t size,
+                     int level,
+                     std::vector<uint8_t>* scratch,
+                     size_t* written,
+                     std::string* error) {
+  *written = 0;
+  {
+    // Claim the chunk so a duplicate in the same batch is not written twice.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!chunks_.insert(digest).second) return true;
+  }
+
+  uLongf packed = compressBound(static_cast<uLong>(size));
+  scratch->resize(1 + packed);
+  bool compressible = level != 0;
+  if (compressible && size > 2 * kSampleSize) {
+    uLongf sample = packed;
+    compressible = compress2(scratch->data() + 1, &sample,
+                             data + (size - kSampleSize) / 2, kSampleSize,
+                             level) == Z_OK &&
+                   sample <= kSampleSize / 8 * 7;
+  }
+  const bool deflated =
+      compressible &&
+      compress2(scratch->data() + 1, &packed, data, static_cast<uLong>(size),
+                level) == Z_OK &&
+      packed < size;
+  if (deflated) {
+    (*scratch)[0] = kDeflated;
+    scratch->resize(1 + packed);
+  } else {
+    // Incompressible, or compression is off.
+    (*scratch)[0] = kStored;
+    scratch->resize(1 + size);
+    std::memcpy(scratch->data() + 1, data, size);
+  }
+
+  const std::string path = ChunkPath(digest);
+  const std::string tmp = path.substr(0, path.rfind('/') + 1) + ".tmp-" +
+                          std::to_string(getpid()) + "-" +
+                          std::to_string(g_temp_counter++);
+  const int fd =
+      open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  bool ok = fd >= 0 && WriteAll(fd, scratch->data(), scratch->size()) &&
+            fsync(fd) == 0;
+  if (fd >= 0) ok = close(fd) == 0 && ok;
+  // Renamed into place only when complete, so a reader never sees a torn
+  // chunk.
+  if (ok) ok = rename(tmp.c_str(), path.c_str()) == 0;
+  if (!ok) {
+    *error = "cannot write " + path + ": " + std::strerror(errno);
+    unlink(tmp.c_str());
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunks_.erase(digest);
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsynced_dirs_[digest[0]] = true;
+  }
+  *written = scratch->size();
+  return true;
+}
+
+bool ChunkStore::Sync(std::string* error) {
+  std::array<bool, 256> dirs;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dirs = unsynced_dirs_;
+    unsynced_dirs_.fill(false);
+  }
+  bool ok = true;
+  for (int i = 0; ok && i < 256; i++) {
+    if (!dirs[i]) continue;
+    const uint8_t byte = static_cast<uint8_t>(i);
+    ok = SyncDir(root_ + "/chunks/" + HexEncode(&byte, 1), error);
+  }
+  // Covers a store created by this run: its subdirectories and marker.
+  ok = ok && SyncDir(root_ + "/chunks", error) &&
+       SyncDir(snapshots_dir(), error) && SyncDir(root_, error);
+  if (!ok) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < 256; i++) unsynced_dirs_[i] |= dirs[i];
+  }
+  return ok;
+}
+
+bool ChunkStore::Get(const Sha256Digest& digest,
+                     size_t size,
+                     std::vector<uint8_t>* out,
+                     std::string* error) const {
+  const std::string path = ChunkPath(digest);
+  std::vector<uint8_t> raw;
+  if (!ReadFile(path, &raw)) {
+    *error = "cannot read chunk " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  out->resize(size);
+  bool ok;
+  if (raw.empty()) {
+    ok = false;
+  } else if (raw[0] == kDeflated) {
+    uLongf unpacked = static_cast<uLongf>(size);
+    ok = uncompress(out->data(), &unpacked, raw.data() + 1,
+                    static_cast<uLong>(raw.size() - 1)) == Z_OK &&
+         unpacked == size;
+  } else {
+    ok = raw[0] == kStored && raw.size() - 1 == size;
+    if (ok) std::memcpy(out->data(), raw.data() + 1, size);
+  }
+  if (!ok || Sha256::Of(out->data(), out->size()) != digest) {
+    *error = "corrupt chunk " + path;
+    return false;
+  }
+  return true;
+}
+
+std::vector<Sha256Digest> ChunkStore::List() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::vector<Sha256Digest>(chunks_.begin(), chunks_.end());
+}
+
+bool ChunkStore::Remove(const Sha256Digest& digest,
+                        uint64_t* freed_bytes,
+                        std::string* error) {
+  const std::string path = ChunkPath(digest);
+  struct stat st;
+  *freed_bytes = stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+  if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+    *error = "cannot remove " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  chunks_.erase(digest);
+  return true;
+}
+
+void ChunkStore::RemoveStaleTemporaries() {
+  for (int i = 0; i < 256; i++) {
+    const uint8_t byte = static_cast<uint8_t>(i);
+    const std::string dir = root_ + "/chunks/" + HexEncode(&byte, 1);
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) continue;
+    while (dirent* e = readdir(d)) {
+      if (std::strncmp(e->d_name, ".tmp-", 5) == 0) {
+        unlinkat(dirfd(d), e->d_name, 0);
+      }
+    }
+    closedir(d);
+  }
+}
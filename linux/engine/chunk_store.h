@@ -0,0 +1,102 @@
+#ifndef ENGINE_CHUNK_STORE_H_
+#define ENGINE_CHUNK_STORE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "sha256.h"
+
+// Content-addressed chunk directory of a backup store:
+//
+//   <root>/store                 format marker
+//   <root>/lock                  flock target, see Open
+//   <root>/chunks/ab/cdef...     one file per chunk, named by its SHA-256
+//   <root>/snapshots/<name>/...  manifests (see snapshot.h)
+//
+// A chunk file is one codec byte (0 stored, 1 zlib) followed by the data.
+// The set of stored chunks is read once at Open, so deduplication never
+// touches the disk. Put and Get are thread-safe.
+class ChunkStore {
+ public:
+  // How Open locks the store. Backups, restores and listings share it;
+  // prune removes chunks no manifest names yet, so it needs the store to
+  // itself.
+  enum class Access { kShared, kExclusive };
+
+  ChunkStore() = default;
+  ~ChunkStore();
+  ChunkStore(const ChunkStore&) = delete;
+  ChunkStore& operator=(const ChunkStore&) = delete;
+
+  // Opens the store at |root|, first creating it when |create| is set and
+  // nothing is there yet. Blocks until it holds an flock on <root>/lock in
+  // |access| mode, and keeps it until the ChunkStore is destroyed. The lock
+  // is taken before the chunk directories are read, so the set of chunks
+  // this object trusts cannot be pruned under it.
+  bool Open(const std::string& root,
+            bool create,
+            Access access,
+            std::string* error);
+
+  const std::string& root() const { return root_; }
+  std::string snapshots_dir() const { return root_ + "/snapshots"; }
+
+  bool Contains(const Sha256Digest& digest) const;
+  size_t size() const;
+
+  // Stores |size| bytes under |digest| unless the chunk is already there or
+  // another thread is writing it. |written| is the number of bytes that went
+  // to disk, 0 for a duplicate. |scratch| is a per-thread compression
+  // buffer; |level| is the zlib level.
+  bool Put(const Sha256Digest& digest,
+           const uint8_t* data,
+           size_t size,
+           int level,
+           std::vector<uint8_t>* scratch,
+           size_t* written,
+           std::string* error);
+
+  // Makes every chunk Put so far durable. Chunk files are fsynced as they
+  // are written; this fsyncs the directories that gained entries, and the
+  // store's own directories. Call it before writing a manifest that refers
+  // to the chunks, so a crash never leaves a snapshot without its data.
+  bool Sync(std::string* error);
+
+  // Reads, decompresses and verifies one chunk of |size| bytes.
+  bool Get(const Sha256Digest& digest,
+           size_t size,
+           std::vector<uint8_t>* out,
+           std::string* error) const;
+
+  // For prune: every stored chunk, and removal of one. Only on a store
+  // opened with Access::kExclusive, so no backup is writing into it.
+  std::vector<Sha256Digest> List() const;
+  bool Remove(const Sha256Digest& digest,
+              uint64_t* freed_bytes,
+              std::string* error);
+  // Deletes temporary files left behind by interrupted writers. Exclusive
+  // access only, like Remove.
+  void RemoveStaleTemporaries();
+
+ private:
+  bool Create(std::string* error);
+  bool CreateLocked(std::string* error);
+  bool Lock(Access access, std::string* error);
+  std::string ChunkPath(const Sha256Digest& digest) const;
+
+  std::string root_;
+  int lock_fd_ = -1;
+  mutable std::mutex mutex_;
+  // Chunks on disk or being written. Guarded by mutex_.
+  std::unordered_set<Sha256Digest, Sha256DigestHash> chunks_;
+  // Chunk directories renamed into since the last Sync, by first digest
+  // byte. Guarded by mutex_.
+  std::array<bool, 256> unsynced_dirs_{};
+};
+
+#endif  // ENGINE_CHUNK_STORE_H_
@@ -0,0 +1,59 @@
+#include "chunker.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// log2(kAvgSize). Before the average size a cut needs two extra zero bits,
+// after it two fewer, which pulls chunk sizes toward the average
+// ("normalization level 2" in the FastCDC paper).
+constexpr int kAvgBits = 16;
+static_assert(size_t{1} << kAvgBits == ChunkParams::kAvgSize,
+              "kAvgBits must match kAvgSize");
+
+// The hash shifts left once per byte, so its high bits cover the longest
+// window; masks take their bits from the top.
+constexpr uint64_t TopBits(int bits) {
+  return ~uint64_t{0} << (64 - bits);
+}
+constexpr uint64_t kMaskSmall = TopBits(kAvgBits + 2);
+constexpr uint64_t kMaskLarge = TopBits(kAvgBits - 2);
+
+// Fixed pseudo-random table (splitmix64 from a constant seed), part of the
+// store format.
+std::array<uint64_t, 256> MakeGearTable() {
+  std::array<uint64_t, 256> table;
+  uint64_t state = 0x6769746772617068;  // "gitgraph"
+  for (uint64_t& entry : table) {
+    state += 0x9e3779b97f4a7c15;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    entry = z ^ (z >> 31);
+  }
+  return table;
+}
+
+const std::array<uint64_t, 256> kGear = MakeGearTable();
+
+}  // namespace
+
+size_t FindChunkEnd(const uint8_t* data, size_t size) {
+  if (size <= ChunkParams::kMinSize) return size;
+  const size_t normal = std::min(ChunkParams::kAvgSize, size);
+  const size_t end = std::min(ChunkParams::kMaxSize, size);
+  // Boundaries inside the minimum size are never taken, so hashing starts
+  // there (cut-point skipping).
+  uint64_t hash = 0;
+  size_t i = ChunkParams::kMinSize;
+  for (; i < normal; i++) {
+    hash = (hash << 1) + kGear[data[i]];
+    if ((hash & kMaskSmall) == 0) return i + 1;
+  }
+  for (; i < end; i++) {
+    hash = (hash << 1) + kGear[data[i]];
+    if ((hash & kMaskLarge) == 0) return i + 1;
+  }
+  return end;
+}
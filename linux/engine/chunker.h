@@ -0,0 +1,25 @@
+#ifndef ENGINE_CHUNKER_H_
+#define ENGINE_CHUNKER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Content-defined chunk boundaries (FastCDC: gear rolling hash with
+// normalized chunking). Cut points depend only on the bytes just before
+// them, so an insertion in the middle of a file moves one or two
+// boundaries and every other chunk keeps its hash. Changing any of these
+// constants or the gear table changes every boundary and loses
+// deduplication against existing stores.
+struct ChunkParams {
+  static constexpr size_t kMinSize = 16 * 1024;
+  static constexpr size_t kAvgSize = 64 * 1024;
+  static constexpr size_t kMaxSize = 256 * 1024;
+};
+
+// Returns the length of the chunk starting at |data|. |size| must be at
+// least ChunkParams::kMaxSize unless |data| runs to the end of the input,
+// otherwise the cut may land at the end of the buffer instead of where the
+// content puts it.
+size_t FindChunkEnd(const uint8_t* data, size_t size);
+
+#endif  // ENGINE_CHUNKER_H_
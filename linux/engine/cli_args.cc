@@ -0,0 +1,28 @@
+#include "cli_args.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+
+bool ParseIntArg(const char* text, int64_t min, int64_t max, int64_t* out) {
+  if (text == nullptr || *text == 0) return false;
+  char* end = nullptr;
+  errno = 0;
+  const long long value = std::strtoll(text, &end, 10);
+  if (errno != 0 || *end != 0 || value < min || value > max) return false;
+  *out = value;
+  return true;
+}
+
+bool ParseDoubleArg(const char* text, double min, double max, double* out) {
+  if (text == nullptr || *text == 0) return false;
+  char* end = nullptr;
+  errno = 0;
+  const double value = std::strtod(text, &end);
+  if (errno != 0 || *end != 0 || !std::isfinite(value) || value < min ||
+      value > max) {
+    return false;
+  }
+  *out = value;
+  return true;
+}
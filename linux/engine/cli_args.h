@@ -0,0 +1,12 @@
+#ifndef ENGINE_CLI_ARGS_H_
+#define ENGINE_CLI_ARGS_H_
+
+#include <cstdint>
+
+// Strict number parsing for the command-line tools. The whole argument must
+// be a number within [min, max], so "--threads 4x" or "--scale abc" is a
+// usage error instead of quietly becoming 4 or 0.
+bool ParseIntArg(const char* text, int64_t min, int64_t max, int64_t* out);
+bool ParseDoubleArg(const char* text, double min, double max, double* out);
+
+#endif  // ENGINE_CLI_ARGS_H_
@@ -0,0 +1,316 @@
+#include "commit_log.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+#include "git_process.h"
+
+namespace {
+
+constexpr char kFieldSeparator = '\x1f';
+constexpr size_t kMaxOidSize = 32;
+
+std::string Trim(const std::string& s) {
+  size_t b = 0;
+  size_t e = s.size();
+  while (b < e && (s[b] == ' ' || s[b] == '\t')) b++;
+  while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t')) e--;
+  return s.substr(b, e - b);
+}
+
+bool StartsWith(const std::string& s, const char* prefix) {
+  return s.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+uint32_t SlotHash(const uint8_t* oid) {
+  // Object ids are already uniformly distributed.
+  uint32_t h;
+  std::memcpy(&h, oid, sizeof(h));
+  return h;
+}
+
+// Splits "<seconds> <+hhmm>" from `--date=raw`. git prints nothing for
+// timestamps it cannot format.
+void ParseRawDate(const std::string& raw, int64_t* time, int16_t* tz) {
+  *time = kNoDate;
+  *tz = 0;
+  const size_t sp = raw.find(' ');
+  if (raw.empty() || sp == std::string::npos || raw.size() != sp + 6) return;
+  char* end = nullptr;
+  const long long seconds = std::strtoll(raw.c_str(), &end, 10);
+  if (end != raw.c_str() + sp) return;
+  const int hhmm = std::atoi(raw.c_str() + sp + 2);
+  const int minutes = hhmm / 100 * 60 + hhmm % 100;
+  *time = seconds;
+  *tz = static_cast<int16_t>(raw[sp + 1] == '-' ? -minutes : minutes);
+}
+
+// Columns as they are parsed, before they are frozen into the arena.
+struct LogBuilder {
+  uint32_t oid_size = 0;
+  uint32_t count = 0;
+  std::vector<uint8_t> oids;
+  std::vector<uint8_t> trees;
+  std::vector<uint32_t> parent_offsets{0};
+  std::vector<uint8_t> parent_oids;
+  std::vector<uint32_t> ref_offsets{0};
+  std::vector<uint32_t> refs;
+  std::vector<uint32_t> authors;
+  std::vector<uint32_t> subjects;
+  std::vector<int64_t> dates;
+  std::vector<int16_t> tz_offsets;
+  std::unordered_map<std::string, uint32_t> string_ids;
+  std::vector<uint32_t> string_offsets{0};
+  std::string strings;
+  std::string error;
+
+  uint32_t Intern(std::string s) {
+    auto it = string_ids.find(s);
+    if (it != string_ids.end()) return it->second;
+    const uint32_t id = static_cast<uint32_t>(string_offsets.size() - 1);
+    strings += s;
+    string_offsets.push_back(static_cast<uint32_t>(strings.size()));
+    string_ids.emplace(std::move(s), id);
+    return id;
+  }
+
+  bool AppendHex(const char* hex, size_t size, std::vector<uint8_t>* out) {
+    if (oid_size == 0 && (size == 40 || size == 64)) {
+      oid_size = static_cast<uint32_t>(size / 2);
+    }
+    const size_t at = out->size();
+    out->resize(at + oid_size);
+    if (size != oid_size * 2 || !ParseHex(hex, size, out->data() + at)) {
+      error = "unsupported object id " + std::string(hex, size);
+      return false;
+    }
+    return true;
+  }
+
+  void AddLine(const char* data, size_t size) {
+    if (!error.empty()) return;
+    std::string fields[7];
+    size_t f = 0;
+    for (size_t i = 0; i < size; i++) {
+      if (data[i] == kFieldSeparator && f < 6) {
+        f++;
+      } else {
+        fields[f].push_back(data[i]);
+      }
+    }
+    if (f < 6 || fields[0].empty()) return;
+    if (!AppendHex(fields[0].data(), fields[0].size(), &oids) ||
+        !AppendHex(fields[1].data(), fields[1].size(), &trees)) {
+      return;
+    }
+    const std::string& parents = fields[2];
+    size_t p = 0;
+    while (p < parents.size()) {
+      size_t sp = parents.find(' ', p);
+      if (sp == std::string::npos) sp = parents.size();
+      if (sp > p && !AppendHex(parents.data() + p, sp - p, &parent_oids)) {
+        return;
+      }
+      p = sp + 1;
+    }
+    parent_offsets.push_back(
+        static_cast<uint32_t>(parent_oids.size() / oid_size));
+    for (auto& ref : ParseDecoration(fields[3])) {
+      refs.push_back(Intern(std::move(ref)));
+    }
+    ref_offsets.push_back(static_cast<uint32_t>(refs.size()));
+    subjects.push_back(Intern(std::move(fields[4])));
+    authors.push_back(Intern(std::move(fields[5])));
+    int64_t time;
+    int16_t tz;
+    ParseRawDate(fields[6], &time, &tz);
+    dates.push_back(time);
+    tz_offsets.push_back(tz);
+    count++;
+  }
+};
+
+}  // namespace
+
+std::vector<std::string> ParseDecoration(const std::string& decoration) {
+  std::vector<std::string> refs;
+  size_t start = 0;
+  while (start <= decoration.size()) {
+    size_t comma = decoration.find(',', start);
+    if (comma == std::string::npos) comma = decoration.size();
+    std::string item = Trim(decoration.substr(start, comma - start));
+    start = comma + 1;
+    if (item.empty()) continue;
+    if (StartsWith(item, "HEAD ->")) item = Trim(item.substr(7));
+    if (StartsWith(item, "tag:")) item = Trim(item.substr(4));
+    refs.push_back(item);
+  }
+  return refs;
+}
+
+std::string FormatIsoDate(int64_t time, int tz_offset) {
+  if (time == kNoDate) return std::string();
+  const int64_t local = time + static_cast<int64_t>(tz_offset) * 60;
+  // git refuses local times before the epoch ("Timestamp before Unix
+  // epoch") and prints nothing for them.
+  if (local < 0) return std::string();
+  int64_t days = local / 86400;
+  int64_t secs = local % 86400;
+  if (secs < 0) {
+    secs += 86400;
+    days--;
+  }
+  // Civil date from days since 1970-01-01 (Howard Hinnant's algorithm).
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const int64_t doe = days - era * 146097;
+  const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const int64_t mp = (5 * doy + 2) / 153;
+  const int day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+  const int month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+  const int64_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+  const int tz = tz_offset < 0 ? -tz_offset : tz_offset;
+  char buf[64];
+  std::snprintf(buf, sizeof(buf),
+                "%04" PRId64 "-%02d-%02d %02d:%02d:%02d %c%02d%02d", year,
+                month, day, static_cast<int>(secs / 3600),
+                static_cast<int>(secs / 60 % 60), static_cast<int>(secs % 60),
+                tz_offset < 0 ? '-' : '+', tz / 60, tz % 60);
+  return buf;
+}
+
+std::string CommitLog::id(uint32_t row) const {
+  return HexEncode(oid(row), c_.oid_size);
+}
+
+bool CommitLog::GetOid(uint32_t row, Oid* out) const {
+  if (c_.oid_size != kOidSize) return false;
+  std::memcpy(out->data(), oid(row), kOidSize);
+  return true;
+}
+
+bool CommitLog::GetTree(uint32_t row, Oid* out) const {
+  if (c_.oid_size != kOidSize) return false;
+  std::memcpy(out->data(), tree(row), kOidSize);
+  return true;
+}
+
+std::string CommitLog::parent_id(uint32_t row, size_t i) const {
+  const uint32_t edge = c_.parent_offsets[row] + static_cast<uint32_t>(i);
+  if (c_.parents[edge] != kNoCommit) return id(c_.parents[edge]);
+  const uint32_t* end = c_.external_edges + c_.external_count;
+  const uint32_t* it = std::lower_bound(c_.external_edges, end, edge);
+  return HexEncode(c_.external_oids + (it - c_.external_edges) * c_.oid_size,
+                   c_.oid_size);
+}
+
+std::string CommitLog::date(uint32_t row) const {
+  return FormatIsoDate(c_.dates[row], c_.tz_offsets[row]);
+}
+
+uint32_t CommitLog::Find(const std::string& hex) const {
+  uint8_t raw[kMaxOidSize];
+  if (c_.count == 0 || hex.size() != c_.oid_size * 2 ||
+      !ParseHex(hex.data(), hex.size(), raw)) {
+    return kNoCommit;
+  }
+  return Find(raw);
+}
+
+uint32_t CommitLog::Find(const uint8_t* raw) const {
+  if (c_.count == 0) return kNoCommit;
+  for (uint32_t slot = SlotHash(raw) & slot_mask_;;
+       slot = (slot + 1) & slot_mask_) {
+    const uint32_t row = slots_[slot];
+    if (row == kNoCommit) return kNoCommit;
+    if (std::memcmp(oid(row), raw, c_.oid_size) == 0) return row;
+  }
+}
+
+bool LoadCommitLog(const std::string& repo_path,
+                   CommitLog* log,
+                   std::string* error) {
+  *log = CommitLog();
+  const std::vector<std::string> args = {
+      "log",
+      "--all",
+      "--date=raw",
+      "--encoding=UTF-8",
+      "--pretty=format:%H%x1f%T%x1f%P%x1f%D%x1f%s%x1f%an%x1f%ad",
+      "--topo-order",
+  };
+  LogBuilder b;
+  auto on_line = [&b](const char* data, size_t size) { b.AddLine(data, size); };
+  if (!RunGit(repo_path, args, on_line, error)) return false;
+  if (!b.error.empty()) {
+    *error = b.error;
+    return false;
+  }
+
+  const uint32_t n = b.count;
+  const uint32_t w = b.oid_size;
+  const size_t edges = b.parent_offsets.back();
+  uint32_t slot_count = 1;
+  while (slot_count < 2 * static_cast<uint64_t>(n)) slot_count <<= 1;
+  // Size the arena to hold everything in one block, with room for padding
+  // between columns.
+  const size_t total =
+      n * sizeof(int64_t) +
+      (2 * (n + 1) + edges + b.refs.size() + 2 * n + b.string_offsets.size() +
+       slot_count) * sizeof(uint32_t) +
+      edges * (sizeof(uint32_t) + w) + n * sizeof(int16_t) + 2 * n * w +
+      b.strings.size() + 16 * alignof(int64_t);
+  CommitLog out;
+  out.arena_ = Arena(total);
+  Arena& arena = out.arena_;
+  CommitColumns& c = out.c_;
+  c.count = n;
+  c.oid_size = w;
+  c.dates = arena.Copy(b.dates);
+  c.parent_offsets = arena.Copy(b.parent_offsets);
+  c.ref_offsets = arena.Copy(b.ref_offsets);
+  c.refs = arena.Copy(b.refs);
+  c.authors = arena.Copy(b.authors);
+  c.subjects = arena.Copy(b.subjects);
+  c.string_count = static_cast<uint32_t>(b.string_offsets.size() - 1);
+  c.string_offsets = arena.Copy(b.string_offsets);
+  c.oids = arena.Copy(b.oids);
+  c.trees = arena.Copy(b.trees);
+
+  uint32_t* slots = arena.Allocate<uint32_t>(slot_count);
+  std::fill(slots, slots + slot_count, kNoCommit);
+  out.slots_ = slots;
+  out.slot_mask_ = slot_count - 1;
+  for (uint32_t row = 0; row < n; row++) {
+    uint32_t slot = SlotHash(out.oid(row)) & out.slot_mask_;
+    while (slots[slot] != kNoCommit) slot = (slot + 1) & out.slot_mask_;
+    slots[slot] = row;
+  }
+
+  uint32_t* parents = arena.Allocate<uint32_t>(edges);
+  std::vector<uint32_t> external_edges;
+  std::vector<uint8_t> external_oids;
+  for (size_t e = 0; e < edges; e++) {
+    const uint8_t* raw = b.parent_oids.data() + e * w;
+    parents[e] = out.Find(raw);
+    if (parents[e] == kNoCommit) {
+      external_edges.push_back(static_cast<uint32_t>(e));
+      external_oids.insert(external_oids.end(), raw, raw + w);
+    }
+  }
+  c.parents = parents;
+  c.external_count = static_cast<uint32_t>(external_edges.size());
+  c.external_edges = arena.Copy(external_edges);
+  c.tz_offsets = arena.Copy(b.tz_offsets);
+  c.external_oids = arena.Copy(external_oids);
+  char* strings = arena.Allocate<char>(b.strings.size());
+  std::memcpy(strings, b.strings.data(), b.strings.size());
+  c.strings = strings;
+
+  *log = std::move(out);
+  return true;
+}
@@ -0,0 +1,155 @@
+#ifndef ENGINE_COMMIT_LOG_H_
+#define ENGINE_COMMIT_LOG_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+#include "oid.h"
+
+// Ordinal used for parents that are not part of the loaded history, e.g.
+// the boundary of a shallow clone.
+constexpr uint32_t kNoCommit = UINT32_MAX;
+
+// Date column value for commits git prints no date for (timestamps before
+// the epoch).
+constexpr int64_t kNoDate = INT64_MIN;
+
+// Read-only run of uint32 values inside a CommitLog's arena.
+class RowSpan {
+ public:
+  RowSpan(const uint32_t* begin, const uint32_t* end)
+      : begin_(begin), end_(end) {}
+  const uint32_t* begin() const { return begin_; }
+  const uint32_t* end() const { return end_; }
+  size_t size() const { return static_cast<size_t>(end_ - begin_); }
+  bool empty() const { return begin_ == end_; }
+  uint32_t operator[](size_t i) const { return begin_[i]; }
+
+ private:
+  const uint32_t* begin_;
+  const uint32_t* end_;
+};
+
+// The columns of a CommitLog, in row order. Every array lives in the log's
+// arena and stays valid, unchanged, for the log's lifetime, so they can be
+// handed across the FFI boundary as-is (see GgCommitStore).
+struct CommitColumns {
+  uint32_t count = 0;
+  // 20 for SHA-1 repositories, 32 for SHA-256 ones.
+  uint32_t oid_size = 0;
+  const uint8_t* oids = nullptr;   // count * oid_size
+  const uint8_t* trees = nullptr;  // count * oid_size
+  // Parents of row r are parents[parent_offsets[r] .. parent_offsets[r+1]),
+  // as rows, or kNoCommit for parents outside the log.
+  const uint32_t* parent_offsets = nullptr;
+  const uint32_t* parents = nullptr;
+  // Ids of the kNoCommit parents: sorted indices into |parents| and the raw
+  // id for each.
+  uint32_t external_count = 0;
+  const uint32_t* external_edges = nullptr;
+  const uint8_t* external_oids = nullptr;
+  // Ref names of row r are string ids ref_offsets[r] .. ref_offsets[r+1].
+  const uint32_t* ref_offsets = nullptr;
+  const uint32_t* refs = nullptr;
+  const uint32_t* authors = nullptr;   // string id per row
+  const uint32_t* subjects = nullptr;  // string id per row
+  const int64_t* dates = nullptr;      // seconds since the epoch, or kNoDate
+  const int16_t* tz_offsets = nullptr;  // minutes east of UTC
+  // Interned UTF-8 strings; string i is
+  // strings[string_offsets[i] .. string_offsets[i+1]).
+  uint32_t string_count = 0;
+  const uint32_t* string_offsets = nullptr;
+  const char* strings = nullptr;
+};
+
+// One repository's `git log --all --topo-order`, stored column by column:
+// raw object ids, parents as CSR row arrays, interned strings for authors,
+// subjects and refs, and integer dates. A commit costs tens of bytes plus
+// its share of distinct strings, and the whole log is a single arena
+// allocation that is released at once.
+class CommitLog {
+ public:
+  CommitLog() = default;
+  CommitLog(CommitLog&&) = default;
+  CommitLog& operator=(CommitLog&&) = default;
+  CommitLog(const CommitLog&) = delete;
+  CommitLog& operator=(const CommitLog&) = delete;
+
+  uint32_t size() const { return c_.count; }
+  size_t oid_size() const { return c_.oid_size; }
+  const CommitColumns& columns() const { return c_; }
+  // Bytes held by the arena: every column and the string pool.
+  size_t memory_bytes() const { return arena_.bytes(); }
+
+  const uint8_t* oid(uint32_t row) const {
+    return c_.oids + static_cast<size_t>(row) * c_.oid_size;
+  }
+  const uint8_t* tree(uint32_t row) const {
+    return c_.trees + static_cast<size_t>(row) * c_.oid_size;
+  }
+  // Full hex id of |row|.
+  std::string id(uint32_t row) const;
+  // Raw SHA-1 commit / tree id of |row|; false in SHA-256 repositories.
+  bool GetOid(uint32_t row, Oid* out) const;
+  bool GetTree(uint32_t row, Oid* out) const;
+
+  RowSpan parents(uint32_t row) const {
+    return {c_.parents + c_.parent_offsets[row],
+            c_.parents + c_.parent_offsets[row + 1]};
+  }
+  // Hex id of the |i|th parent of |row|, also for parents outside the log.
+  std::string parent_id(uint32_t row, size_t i) const;
+
+  std::string_view string(uint32_t id) const {
+    return {c_.strings + c_.string_offsets[id],
+            c_.string_offsets[id + 1] - c_.string_offsets[id]};
+  }
+  // String ids of |row|'s ref names.
+  RowSpan refs(uint32_t row) const {
+    return {c_.refs + c_.ref_offsets[row], c_.refs + c_.ref_offsets[row + 1]};
+  }
+  std::string_view author(uint32_t row) const {
+    return string(c_.authors[row]);
+  }
+  std::string_view subject(uint32_t row) const {
+    return string(c_.subjects[row]);
+  }
+  int64_t time(uint32_t row) const { return c_.dates[row]; }
+  int16_t tz_offset(uint32_t row) const { return c_.tz_offsets[row]; }
+  // The author date as `git log --date=iso` prints it.
+  std::string date(uint32_t row) const;
+
+  // Row of the commit with full hex id |hex|, or kNoCommit.
+  uint32_t Find(const std::string& hex) const;
+  uint32_t Find(const uint8_t* oid) const;
+
+ private:
+  friend bool LoadCommitLog(const std::string& repo_path,
+                            CommitLog* log,
+                            std::string* error);
+
+  Arena arena_;
+  CommitColumns c_;
+  // Open-addressing id -> row table; kNoCommit marks empty slots.
+  const uint32_t* slots_ = nullptr;
+  uint32_t slot_mask_ = 0;
+};
+
+// Loads the complete topo-ordered history of every ref in |repo_path|.
+bool LoadCommitLog(const std::string& repo_path,
+                   CommitLog* log,
+                   std::string* error);
+
+// Splits a `%D` decoration into ref names the same way the server's
+// _parseRefs does: "HEAD -> " and "tag: " prefixes are dropped.
+std::vector<std::string> ParseDecoration(const std::string& decoration);
+
+// Formats seconds since the epoch at |tz_offset| minutes east of UTC as
+// `git log --date=iso` does: "2024-05-01 12:00:00 +0200". Like git, returns
+// an empty string when the local time falls before 1970.
+std::string FormatIsoDate(int64_t time, int tz_offset);
+
+#endif  // ENGINE_COMMIT_LOG_H_
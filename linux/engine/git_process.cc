@@ -0,0 +1,129 @@
+#include "git_process.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace {
+
+std::vector<std::string> BuildArgv(const std::string& repo_path,
+                                   const std::vector<std::string>& args) {
+  std::vector<std::string> argv = {
+      "git", "-c", "i18n.logOutputEncoding=UTF-8", "-c",
+      "core.quotepath=false", "-C", repo_path,
+  };
+  argv.insert(argv.end(), args.begin(), args.end());
+  return argv;
+}
+
+}  // namespace
+
+bool RunGit(const std::string& repo_path,
+            const std::vector<std::string>& args,
+            const GitLineCallback& on_line,
+            std::string* error) {
+  const std::vector<std::string> argv_strings = BuildArgv(repo_path, args);
+  std::vector<char*> argv;
+  for (const auto& s : argv_strings) argv.push_back(const_cast<char*>(s.c_str()));
+  argv.push_back(nullptr);
+
+  int out_pipe[2];
+  int err_pipe[2];
+  if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+    *error = std::string("pipe: ") + std::strerror(errno);
+    return false;
+  }
+  if (pipe2(err_pipe, O_CLOEXEC) != 0) {
+    close(out_pipe[0]);
+    close(out_pipe[1]);
+    *error = std::string("pipe: ") + std::strerror(errno);
+    return false;
+  }
+
+  const pid_t pid = fork();
+  if (pid < 0) {
+    *error = std::string("fork: ") + std::strerror(errno);
+    close(out_pipe[0]);
+    close(out_pipe[1]);
+    close(err_pipe[0]);
+    close(err_pipe[1]);
+    return false;
+  }
+  if (pid == 0) {
+    dup2(out_pipe[1], STDOUT_FILENO);
+    dup2(err_pipe[1], STDERR_FILENO);
+    close(out_pipe[0]);
+    close(out_pipe[1]);
+    close(err_pipe[0]);
+    close(err_pipe[1]);
+    execvp("git", argv.data());
+    _exit(127);
+  }
+  close(out_pipe[1]);
+  close(err_pipe[1]);
+
+  // Drain both pipes together so a chatty stderr cannot block git.
+  std::string pending;
+  std::string err_text;
+  char buf[65536];
+  pollfd fds[2] = {{out_pipe[0], POLLIN, 0}, {err_pipe[0], POLLIN, 0}};
+  int open_fds = 2;
+  while (open_fds > 0) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    for (auto& fd : fds) {
+      if (fd.fd < 0 || (fd.revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+        continue;
+      }
+      const ssize_t n = read(fd.fd, buf, sizeof(buf));
+      if (n <= 0) {
+        if (n < 0 && errno == EINTR) continue;
+        close(fd.fd);
+        fd.fd = -1;
+        open_fds--;
+        continue;
+      }
+      if (fd.fd == err_pipe[0]) {
+        err_text.append(buf, static_cast<size_t>(n));
+        continue;
+      }
+      pending.append(buf, static_cast<size_t>(n));
+      size_t start = 0;
+      for (;;) {
+        const size_t nl = pending.find('\n', start);
+        if (nl == std::string::npos) break;
+        size_t len = nl - start;
+        if (len > 0 && pending[start + len - 1] == '\r') len--;
+        on_line(pending.data() + start, len);
+        start = nl + 1;
+      }
+      pending.erase(0, start);
+    }
+  }
+  if (!pending.empty()) on_line(pending.data(), pending.size());
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    *error = err_text.empty() ? "git error" : err_text;
+    return false;
+  }
+  return true;
+}
+
+bool RunGitLines(const std::string& repo_path,
+                 const std::vector<std::string>& args,
+                 std::vector<std::string>* lines,
+                 std::string* error) {
+  return RunGit(
+      repo_path, args,
+      [lines](const char* data, size_t size) { lines->emplace_back(data, size); },
+      error);
+}
@@ -0,0 +1,26 @@
+#ifndef ENGINE_GIT_PROCESS_H_
+#define ENGINE_GIT_PROCESS_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Called once per line of git's standard output, without the trailing
+// newline. The data is only valid for the duration of the call.
+using GitLineCallback = std::function<void(const char* data, size_t size)>;
+
+// Runs `git -C <repo_path> <args...>` with the same encoding overrides the
+// Dart server passes, streaming stdout line by line. Returns false and fills
+// |error| with git's stderr when the process cannot start or exits non-zero.
+bool RunGit(const std::string& repo_path,
+            const std::vector<std::string>& args,
+            const GitLineCallback& on_line,
+            std::string* error);
+
+// Like RunGit, but collects the output lines into |lines|.
+bool RunGitLines(const std::string& repo_path,
+                 const std::vector<std::string>& args,
+                 std::vector<std::string>* lines,
+                 std::string* error);
+
+#endif  // ENGINE_GIT_PROCESS_H_
@@ -0,0 +1,150 @@
+#include "gitgraph_engine.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "change_stats.h"
+#include "commit_log.h"
+#include "json_writer.h"
+#include "path_filter.h"
+#include "repo_state.h"
+#include "search_index.h"
+
+namespace {
+
+GgBuffer ToBuffer(const std::string& json) {
+  GgBuffer buffer;
+  buffer.size = static_cast<int64_t>(json.size());
+  buffer.data = static_cast<uint8_t*>(std::malloc(json.size() + 1));
+  if (buffer.data == nullptr) {
+    buffer.size = 0;
+    return buffer;
+  }
+  std::memcpy(buffer.data, json.data(), json.size());
+  buffer.data[json.size()] = 0;
+  return buffer;
+}
+
+// A GgCommitStore that keeps its repository's history alive.
+struct StoreHandle : GgCommitStore {
+  std::shared_ptr<RepoState> repo;
+};
+
+uint32_t ClampRow(int64_t value) {
+  if (value < 0) return 0;
+  if (value > static_cast<int64_t>(UINT32_MAX)) return UINT32_MAX;
+  return static_cast<uint32_t>(value);
+}
+
+}  // namespace
+
+void* gg_alloc(int64_t size) {
+  return std::malloc(size > 0 ? static_cast<size_t>(size) : 1);
+}
+
+void gg_free(void* ptr) {
+  std::free(ptr);
+}
+
+GgBuffer gg_history_window(const char* repo_path,
+                           int64_t start,
+                           int64_t count) {
+  std::string error;
+  auto repo = AcquireRepo(repo_path, &error);
+  if (!repo) return ToBuffer(JsonError(error));
+  return ToBuffer(HistoryWindowJson(repo->log, AcquireLayout(repo.get()),
+                                    ClampRow(start), ClampRow(count)));
+}
+
+GgBuffer gg_path_filter(const char* repo_path, const char* path) {
+  std::string error;
+  auto repo = AcquireRepo(repo_path, &error);
+  if (!repo) return ToBuffer(JsonError(error));
+  return ToBuffer(PathFilterJson(repo.get(), path));
+}
+
+GgBuffer gg_commit_stats(const char* repo_path, const char* commit_ids) {
+  std::string error;
+  auto repo = AcquireRepo(repo_path, &error);
+  if (!repo) return ToBuffer(JsonError(error));
+  std::vector<std::string> ids;
+  const char* p = commit_ids;
+  while (*p != 0) {
+    const char* end = std::strchr(p, '\n');
+    if (end == nullptr) end = p + std::strlen(p);
+    if (end > p) ids.emplace_back(p, end);
+    p = *end == 0 ? end : end + 1;
+  }
+  return ToBuffer(CommitStatsJson(repo.get(), ids));
+}
+
+GgBuffer gg_search(const char* repo_path, const char* query, int64_t limit) {
+  std::string error;
+  auto repo = AcquireRepo(repo_path, &error);
+  if (!repo) return ToBuffer(JsonError(error));
+  return ToBuffer(SearchJson(repo->log, AcquireLayout(repo.get()),
+                             AcquireSearchIndex(repo.get()), query,
+                             ClampRow(limit)));
+}
+
+const GgCommitStore* gg_commit_store_open(const char* repo_path,
+                                          GgBuffer* error) {
+  std::string message;
+  auto repo = AcquireRepo(repo_path, &message);
+  if (!repo) {
+    if (error != nullptr) *error = ToBuffer(JsonError(message));
+    return nullptr;
+  }
+  const CommitColumns& c = repo->log.columns();
+  auto* handle = new StoreHandle();
+  GgCommitStore& v = *handle;
+  v.count = c.count;
+  v.oid_size = static_cast<int32_t>(c.oid_size);
+  v.oids = c.oids;
+  v.trees = c.trees;
+  v.parent_offsets = c.parent_offsets;
+  v.parents = c.parents;
+  v.external_count = c.external_count;
+  v.external_edges = c.external_edges;
+  v.external_oids = c.external_oids;
+  v.ref_offsets = c.ref_offsets;
+  v.refs = c.refs;
+  v.authors = c.authors;
+  v.subjects = c.subjects;
+  v.dates = c.dates;
+  v.tz_offsets = c.tz_offsets;
+  v.string_count = c.string_count;
+  v.string_offsets = c.string_offsets;
+  v.strings = reinterpret_cast<const uint8_t*>(c.strings);
+  v.memory_bytes = static_cast<int64_t>(repo->log.memory_bytes());
+  handle->repo = std::move(repo);
+  return handle;
+}
+
+void gg_commit_store_close(const GgCommitStore* store) {
+  delete static_cast<const StoreHandle*>(store);
+}
+
+int64_t gg_format_date(int64_t time,
+                       int32_t tz_offset,
+                       char* out,
+                       int64_t capacity) {
+  const std::string date = FormatIsoDate(time, tz_offset);
+  if (capacity > 0) {
+    std::memcpy(out, date.data(),
+                std::min(date.size(), static_cast<size_t>(capacity)));
+  }
+  return static_cast<int64_t>(date.size());
+}
+
+void gg_reset(void) {
+  ResetRepos();
+}
+
+void gg_forget(const char* repo_path) {
+  ForgetRepo(repo_path);
+}
@@ -0,0 +1,114 @@
+#ifndef ENGINE_GITGRAPH_ENGINE_H_
+#define ENGINE_GITGRAPH_ENGINE_H_
+
+// C interface of the native graph engine, loaded by the Dart server through
+// dart:ffi (see server/lib/native_engine.dart).
+//
+// Every query returns a GgBuffer holding UTF-8 JSON. Failures are reported
+// in-band as {"error": "..."}. The caller owns the buffer and must release
+// it with gg_free().
+
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define GG_EXPORT __attribute__((visibility("default")))
+#else
+#define GG_EXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint8_t* data;
+  int64_t size;
+} GgBuffer;
+
+// Allocates memory the caller may pass back to gg_free(). Used by the Dart
+// side to marshal string arguments without depending on package:ffi.
+GG_EXPORT void* gg_alloc(int64_t size);
+GG_EXPORT void gg_free(void* ptr);
+
+// Rows [start, start + count) of the repository's `--all --topo-order`
+// history, with their lanes and the lane state at |start|.
+GG_EXPORT GgBuffer gg_history_window(const char* repo_path,
+                                     int64_t start,
+                                     int64_t count);
+
+// Commits that changed |path|, with parents rewritten to the nearest such
+// ancestor. Uses commit-graph changed-path Bloom filters when present and
+// builds and persists the engine's own otherwise.
+GG_EXPORT GgBuffer gg_path_filter(const char* repo_path, const char* path);
+
+// Files changed and lines added/removed for each commit in |commit_ids|
+// (newline-separated full ids), each against its first parent. Commits are
+// diffed in parallel and the results cached per (tree, parent tree) pair.
+GG_EXPORT GgBuffer gg_commit_stats(const char* repo_path,
+                                   const char* commit_ids);
+
+// Commits whose subject, author or refs contain every whitespace-separated
+// term of |query| (case-insensitive), in row order with their lanes. At
+// most |limit| matches are listed; "total" counts all of them.
+GG_EXPORT GgBuffer gg_search(const char* repo_path,
+                             const char* query,
+                             int64_t limit);
+
+// Read-only column view of a repository's loaded history, one entry per
+// row of the `--all --topo-order` log (see CommitColumns in commit_log.h).
+// Parents are rows, or UINT32_MAX for parents outside the history; their
+// ids are in external_oids, keyed by index into |parents|. Authors,
+// subjects and refs are ids into the interned string pool. Every pointer
+// stays valid until gg_commit_store_close(), even across gg_reset().
+typedef struct {
+  int64_t count;
+  int32_t oid_size;
+  const uint8_t* oids;
+  const uint8_t* trees;
+  const uint32_t* parent_offsets;
+  const uint32_t* parents;
+  int64_t external_count;
+  const uint32_t* external_edges;
+  const uint8_t* external_oids;
+  const uint32_t* ref_offsets;
+  const uint32_t* refs;
+  const uint32_t* authors;
+  const uint32_t* subjects;
+  // Seconds since the epoch (INT64_MIN when git prints no date) and the
+  // author's offset from UTC in minutes.
+  const int64_t* dates;
+  const int16_t* tz_offsets;
+  int64_t string_count;
+  const uint32_t* string_offsets;
+  const uint8_t* strings;
+  // Bytes held by the store's arena.
+  int64_t memory_bytes;
+} GgCommitStore;
+
+// Loads (or reuses) the repository's history and pins it for direct reads.
+// Returns NULL and sets |*error| to an {"error": ...} buffer on failure.
+GG_EXPORT const GgCommitStore* gg_commit_store_open(const char* repo_path,
+                                                    GgBuffer* error);
+GG_EXPORT void gg_commit_store_close(const GgCommitStore* store);
+
+// Formats a GgCommitStore date as `git log --date=iso` prints it (see
+// FormatIsoDate in commit_log.h), so clients need no date code of their
+// own. Copies at most |capacity| bytes to |out|, unterminated, and returns
+// the formatted length; 0 when git would print nothing.
+GG_EXPORT int64_t gg_format_date(int64_t time,
+                                 int32_t tz_offset,
+                                 char* out,
+                                 int64_t capacity);
+
+// Forgets every cached repository, mirroring the server's /reset.
+GG_EXPORT void gg_reset(void);
+
+// Forgets one repository, e.g. after its refs moved. Open commit stores
+// keep their columns, as with gg_reset().
+GG_EXPORT void gg_forget(const char* repo_path);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // ENGINE_GITGRAPH_ENGINE_H_
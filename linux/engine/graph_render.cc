@@ -0,0 +1,532 @@
+#include "graph_render.h"
+
+#include <png.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include "thread_pool.h"
+
+namespace {
+
+namespace rs = render_style;
+
+constexpr size_t kPaletteSize = sizeof(rs::kLanePalette) / sizeof(uint32_t);
+// Ink used for nodes; inks below it are lane palette entries.
+constexpr uint8_t kNodeInk = kPaletteSize;
+// Rows per SVG band; each band is serialized by one pool task.
+constexpr uint32_t kSvgBandRows = 4096;
+// Room for labels to the right of the last lane, as in the paged viewer.
+constexpr double kLabelMargin = 400;
+
+struct Point {
+  double x;
+  double y;
+};
+
+// One child -> parent line, in rows and lanes.
+struct Edge {
+  uint32_t row;
+  uint32_t parent_row;
+  int32_t lane;
+  int32_t parent_lane;
+  uint8_t ink;  // Index into the lane palette.
+};
+
+double LaneX(int32_t lane) {
+  return lane * rs::kLaneWidth + rs::kLaneWidth / 2;
+}
+
+double RowY(uint32_t row) {
+  return row * rs::kRowHeight + rs::kRowHeight / 2;
+}
+
+uint8_t LaneInk(int32_t lane) {
+  return static_cast<uint8_t>(static_cast<size_t>(lane) % kPaletteSize);
+}
+
+// First-parent edges take the child's lane colour, merge edges the parent's,
+// matching PagedGraphPainter.
+std::vector<Edge> CollectEdges(const CommitLog& log,
+                               const HistoryLayout& layout) {
+  std::vector<Edge> edges;
+  edges.reserve(log.size() + log.size() / 8);
+  for (uint32_t row = 0; row < log.size(); row++) {
+    const RowSpan parents = log.parents(row);
+    const int32_t lane = layout.lane_of(row);
+    for (size_t i = 0; i < parents.size(); i++) {
+      if (parents[i] == kNoCommit) continue;
+      const int32_t parent_lane = layout.lane_of(parents[i]);
+      edges.push_back({row, parents[i], lane, parent_lane,
+                       LaneInk(i == 0 ? lane : parent_lane)});
+    }
+  }
+  return edges;
+}
+
+// Control points in layout units, with the base bend both viewer painters
+// use: the curve leaves towards the other lane by clamp(dLane * 8, 8, 24).
+// Like PagedGraphPainter, and unlike GraphPainter, there is no extra bend
+// per node between the ends and no spread between parallel branch-chain
+// edges, since edges here follow parent links rather than branch chains.
+void EdgeCurve(const Edge& e, Point p[4]) {
+  const double x = LaneX(e.lane);
+  const double y = RowY(e.row);
+  const double px = LaneX(e.parent_lane);
+  const double py = RowY(e.parent_row);
+  const double d_lane = std::abs(e.lane - e.parent_lane);
+  const double bend = std::min(std::max(d_lane * 8.0, 8.0), 24.0);
+  const double dir = e.lane <= e.parent_lane ? 1.0 : -1.0;
+  const double mid_y = (y + py) / 2;
+  p[0] = {x, y};
+  p[1] = {x + dir * bend, mid_y};
+  p[2] = {px - dir * bend, mid_y};
+  p[3] = {px, py};
+}
+
+Point CubicAt(const Point p[4], double t) {
+  const double u = 1 - t;
+  const double a = u * u * u;
+  const double b = 3 * u * u * t;
+  const double c = 3 * u * t * t;
+  const double d = t * t * t;
+  return {a * p[0].x + b * p[1].x + c * p[2].x + d * p[3].x,
+          a * p[0].y + b * p[1].y + c * p[2].y + d * p[3].y};
+}
+
+// Parameter at which the curve reaches |y|. Parents always sit below their
+// children and both inner control points share one y, so y(t) is monotonic.
+double SolveY(const Point p[4], double y) {
+  if (CubicAt(p, 0).y >= y) return 0;
+  if (CubicAt(p, 1).y <= y) return 1;
+  double lo = 0;
+  double hi = 1;
+  for (int i = 0; i < 40; i++) {
+    const double mid = (lo + hi) / 2;
+    if (CubicAt(p, mid).y < y) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+double SegmentDistance(Point p, Point a, Point b) {
+  const double dx = b.x - a.x;
+  const double dy = b.y - a.y;
+  const double len2 = dx * dx + dy * dy;
+  double u = len2 == 0 ? 0 : ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2;
+  u = std::min(std::max(u, 0.0), 1.0);
+  const double ex = p.x - (a.x + u * dx);
+  const double ey = p.y - (a.y + u * dy);
+  return std::sqrt(ex * ex + ey * ey);
+}
+
+// Indexed raster for one horizontal band of the image. Index 0 is the
+// background; every ink (the lane colours plus the node colour) gets
+// kCoverageLevels entries pre-blended over it. Overlaps keep whichever ink
+// covers the pixel more, which is exact for a single anti-aliased stroke
+// and close enough where strokes cross, and keeps tiles at one byte per
+// pixel for deflate. Coordinates passed in are absolute image pixels; |top|
+// is the band's first image row.
+class Canvas {
+ public:
+  Canvas(uint32_t width, uint32_t height, double top)
+      : width_(width),
+        height_(height),
+        top_(top),
+        pixels_(static_cast<size_t>(width) * height, 0) {}
+
+  uint32_t width() const { return width_; }
+  uint32_t height() const { return height_; }
+  const uint8_t* row(uint32_t y) const {
+    return pixels_.data() + static_cast<size_t>(y) * width_;
+  }
+
+  static std::vector<png_color> Palette() {
+    std::vector<png_color> palette(1 + kInks * kCoverageLevels);
+    palette[0] = ToPng(rs::kBackground);
+    for (size_t ink = 0; ink < kInks; ink++) {
+      for (int level = 1; level <= kCoverageLevels; level++) {
+        palette[Index(static_cast<uint8_t>(ink), level)] =
+            Mix(rs::kBackground, InkColor(ink),
+                static_cast<double>(level) / kCoverageLevels);
+      }
+    }
+    return palette;
+  }
+
+  void Circle(Point c, double radius, uint8_t ink) {
+    int x0, x1, y0, y1;
+    if (!Clip(c.x - radius - 1, c.x + radius + 1, c.y - radius - 1,
+              c.y + radius + 1, &x0, &x1, &y0, &y1)) {
+      return;
+    }
+    for (int y = y0; y < y1; y++) {
+      const double dy = y + 0.5 + top_ - c.y;
+      for (int x = x0; x < x1; x++) {
+        const double dx = x + 0.5 - c.x;
+        Plot(x, y, ink, radius + 0.5 - std::sqrt(dx * dx + dy * dy));
+      }
+    }
+  }
+
+  // Anti-aliased polyline with round ends.
+  void Polyline(const std::vector<Point>& pts, double width, uint8_t ink) {
+    const double hw = width / 2;
+    for (size_t i = 0; i + 1 < pts.size(); i++) {
+      const Point a = pts[i];
+      const Point b = pts[i + 1];
+      int x0, x1, y0, y1;
+      if (!Clip(std::min(a.x, b.x) - hw - 1, std::max(a.x, b.x) + hw + 1,
+                std::min(a.y, b.y) - hw - 1, std::max(a.y, b.y) + hw + 1, &x0,
+                &x1, &y0, &y1)) {
+        continue;
+      }
+      for (int y = y0; y < y1; y++) {
+        const double py = y + 0.5 + top_;
+        for (int x = x0; x < x1; x++) {
+          Plot(x, y, ink, hw + 0.5 - SegmentDistance({x + 0.5, py}, a, b));
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr int kCoverageLevels = 15;
+  static constexpr size_t kInks = kPaletteSize + 1;
+  static_assert(1 + kInks * kCoverageLevels <= 256, "palette too large");
+
+  static uint32_t InkColor(size_t ink) {
+    return ink == kNodeInk ? rs::kNodeColor : rs::kLanePalette[ink];
+  }
+  static uint8_t Index(uint8_t ink, int level) {
+    return static_cast<uint8_t>(1 + ink * kCoverageLevels + level - 1);
+  }
+  static int LevelOf(uint8_t index) {
+    return index == 0 ? 0 : (index - 1) % kCoverageLevels + 1;
+  }
+  static png_color ToPng(uint32_t rgb) {
+    return {static_cast<png_byte>(rgb >> 16), static_cast<png_byte>(rgb >> 8),
+            static_cast<png_byte>(rgb)};
+  }
+  static png_color Mix(uint32_t under, uint32_t over, double a) {
+    auto channel = [a](uint32_t u, uint32_t o) {
+      return static_cast<png_byte>((u & 0xff) +
+                                   (static_cast<double>(o & 0xff) -
+                                    static_cast<double>(u & 0xff)) *
+                                       a +
+                                   0.5);
+    };
+    return {channel(under >> 16, over >> 16), channel(under >> 8, over >> 8),
+            channel(under, over)};
+  }
+
+  bool Clip(double left,
+            double right,
+            double top,
+            double bottom,
+            int* x0,
+            int* x1,
+            int* y0,
+            int* y1) const {
+    *x0 = std::max(0, static_cast<int>(std::floor(left)));
+    *x1 = std::min(static_cast<int>(width_),
+                   static_cast<int>(std::ceil(right)));
+    *y0 = std::max(0, static_cast<int>(std::floor(top - top_)));
+    *y1 = std::min(static_cast<int>(height_),
+                   static_cast<int>(std::ceil(bottom - top_)));
+    return *x0 < *x1 && *y0 < *y1;
+  }
+
+  void Plot(int x, int y, uint8_t ink, double coverage) {
+    const int level = static_cast<int>(
+        std::min(coverage, 1.0) * kCoverageLevels + 0.5);
+    if (level <= 0) return;
+    uint8_t& p = pixels_[static_cast<size_t>(y) * width_ + x];
+    if (level >= LevelOf(p)) p = Index(ink, level);
+  }
+
+  uint32_t width_;
+  uint32_t height_;
+  double top_;
+  std::vector<uint8_t> pixels_;
+};
+
+bool EncodePng(const std::string& path,
+               const Canvas& canvas,
+               const std::vector<png_color>& palette,
+               int level,
+               std::string* error) {
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (f == nullptr) {
+    *error = "cannot write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  png_structp png =
+      png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  png_infop info = png != nullptr ? png_create_info_struct(png) : nullptr;
+  if (info == nullptr) {
+    png_destroy_write_struct(&png, nullptr);
+    std::fclose(f);
+    *error = "out of memory";
+    return false;
+  }
+  if (setjmp(png_jmpbuf(png))) {
+    png_destroy_write_struct(&png, &info);
+    std::fclose(f);
+    *error = "libpng failed writing " + path;
+    return false;
+  }
+  png_init_io(png, f);
+  png_set_IHDR(png, info, canvas.width(), canvas.height(), 8,
+               PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_set_PLTE(png, info, palette.data(), static_cast<int>(palette.size()));
+  png_set_compression_level(png, level);
+  png_set_compression_strategy(png, Z_RLE);
+  png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+  png_write_info(png, info);
+  for (uint32_t y = 0; y < canvas.height(); y++) {
+    png_write_row(png, canvas.row(y));
+  }
+  png_write_end(png, nullptr);
+  png_destroy_write_struct(&png, &info);
+  if (std::fclose(f) != 0) {
+    *error = "cannot write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+std::string TilePath(const std::string& path, size_t index, size_t tiles) {
+  if (tiles == 1) return path;
+  const size_t slash = path.find_last_of('/');
+  size_t dot = path.find_last_of('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    dot = path.size();
+  }
+  char suffix[16];
+  std::snprintf(suffix, sizeof(suffix), "-%04zu", index);
+  return path.substr(0, dot) + suffix + path.substr(dot);
+}
+
+void AppendF(std::string* out, const char* format, ...) {
+  char buf[512];
+  va_list args;
+  va_start(args, format);
+  const int n = std::vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (n > 0) out->append(buf, std::min<size_t>(n, sizeof(buf) - 1));
+}
+
+void AppendXmlEscaped(std::string* out, std::string_view s) {
+  for (char c : s) {
+    switch (c) {
+      case '&':
+        out->append("&amp;");
+        break;
+      case '<':
+        out->append("&lt;");
+        break;
+      case '>':
+        out->append("&gt;");
+        break;
+      case '"':
+        out->append("&quot;");
+        break;
+      default:
+        out->push_back(c);
+    }
+  }
+}
+
+bool WriteAll(FILE* f, const std::string& s) {
+  return std::fwrite(s.data(), 1, s.size(), f) == s.size();
+}
+
+}  // namespace
+
+bool WritePngTiles(const CommitLog& log,
+                   const HistoryLayout& layout,
+                   const RenderOptions& options,
+                   ThreadPool* pool,
+                   const std::string& path,
+                   std::vector<std::string>* files,
+                   std::string* error) {
+  const double s = options.scale;
+  const uint32_t n = log.size();
+  const uint32_t width = std::max<uint32_t>(
+      1, static_cast<uint32_t>(
+             std::ceil((layout.max_lane() + 1) * rs::kLaneWidth * s)));
+  const uint64_t height = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(n * rs::kRowHeight * s)));
+  if (height > PNG_UINT_31_MAX) {
+    *error = "image too tall; lower --scale";
+    return false;
+  }
+  const uint32_t tile_height = std::max<uint32_t>(options.tile_height, 1);
+  const size_t tiles = static_cast<size_t>((height + tile_height - 1) /
+                                           tile_height);
+  // Thin lines and dots stay visible when zoomed far out.
+  const double edge_width = std::max(rs::kEdgeWidth * s, 1.0);
+  const double radius = std::max(rs::kNodeRadius * s, 1.5);
+
+  // Bucket edges by the tiles their vertical extent crosses.
+  const std::vector<Edge> edges = CollectEdges(log, layout);
+  std::vector<std::vector<uint32_t>> tile_edges(tiles);
+  for (uint32_t i = 0; i < edges.size(); i++) {
+    const double top = RowY(edges[i].row) * s - edge_width;
+    const double bottom = RowY(edges[i].parent_row) * s + edge_width;
+    const size_t first = static_cast<size_t>(std::max(0.0, top)) / tile_height;
+    const size_t last = std::min(
+        tiles - 1, static_cast<size_t>(std::max(0.0, bottom)) / tile_height);
+    for (size_t t = first; t <= last; t++) tile_edges[t].push_back(i);
+  }
+
+  const std::vector<png_color> palette = Canvas::Palette();
+  std::vector<std::string> errors(pool->size());
+  pool->ParallelFor(tiles, [&](size_t t, size_t worker) {
+    if (!errors[worker].empty()) return;
+    const uint64_t y0 = static_cast<uint64_t>(t) * tile_height;
+    const uint64_t y1 = std::min<uint64_t>(height, y0 + tile_height);
+    Canvas canvas(width, static_cast<uint32_t>(y1 - y0),
+                  static_cast<double>(y0));
+
+    std::vector<Point> pts;
+    for (uint32_t i : tile_edges[t]) {
+      Point p[4];
+      EdgeCurve(edges[i], p);
+      for (auto& q : p) q = {q.x * s, q.y * s};
+      // Only flatten the stretch of the curve that lands in this tile.
+      const double ta = SolveY(p, y0 - edge_width - 1);
+      const double tb = SolveY(p, y1 + edge_width + 1);
+      const double span = CubicAt(p, tb).y - CubicAt(p, ta).y;
+      const int segments = static_cast<int>(
+          std::min(std::max(std::ceil((span + 48 * s) / 3), 1.0), 65536.0));
+      pts.clear();
+      for (int k = 0; k <= segments; k++) {
+        pts.push_back(CubicAt(p, ta + (tb - ta) * k / segments));
+      }
+      canvas.Polyline(pts, edge_width, edges[i].ink);
+    }
+
+    const double row_px = rs::kRowHeight * s;
+    const double first_row = std::floor((y0 - radius - 1) / row_px - 0.5);
+    const double last_row = std::ceil((y1 + radius + 1) / row_px - 0.5);
+    const uint32_t r0 = static_cast<uint32_t>(std::max(0.0, first_row));
+    const uint32_t r1 = static_cast<uint32_t>(
+        std::min(static_cast<double>(n) - 1, last_row));
+    for (uint32_t r = r0; n > 0 && r <= r1; r++) {
+      canvas.Circle({LaneX(layout.lane_of(r)) * s, RowY(r) * s}, radius,
+                    kNodeInk);
+    }
+
+    EncodePng(TilePath(path, t, tiles), canvas, palette, options.compression,
+              &errors[worker]);
+  });
+  for (const auto& e : errors) {
+    if (!e.empty()) {
+      *error = e;
+      return false;
+    }
+  }
+  for (size_t t = 0; t < tiles; t++) files->push_back(TilePath(path, t, tiles));
+  return true;
+}
+
+bool WriteSvg(const CommitLog& log,
+              const HistoryLayout& layout,
+              const RenderOptions& options,
+              ThreadPool* pool,
+              const std::string& path,
+              std::string* error) {
+  const uint32_t n = log.size();
+  const std::vector<Edge> edges = CollectEdges(log, layout);
+  // Edges are grouped by the band of their child row.
+  std::vector<size_t> band_start;
+  const size_t bands = std::max<size_t>(1, (n + kSvgBandRows - 1) / kSvgBandRows);
+  for (size_t b = 0, i = 0; b <= bands; b++) {
+    while (i < edges.size() && edges[i].row < b * kSvgBandRows) i++;
+    band_start.push_back(b == bands ? edges.size() : i);
+  }
+
+  struct Band {
+    std::string edges;
+    std::string nodes;
+    std::string labels;
+  };
+  std::vector<Band> out(bands);
+  pool->ParallelFor(bands, [&](size_t b, size_t) {
+    Band& band = out[b];
+    for (size_t i = band_start[b]; i < band_start[b + 1]; i++) {
+      Point p[4];
+      EdgeCurve(edges[i], p);
+      AppendF(&band.edges,
+              "<path d=\"M%.1f %.1fC%.1f %.1f %.1f %.1f %.1f %.1f\" "
+              "stroke=\"#%06x\"/>\n",
+              p[0].x, p[0].y, p[1].x, p[1].y, p[2].x, p[2].y, p[3].x, p[3].y,
+              rs::kLanePalette[edges[i].ink]);
+    }
+    const uint32_t r1 = std::min<uint32_t>(n, (b + 1) * kSvgBandRows);
+    for (uint32_t r = static_cast<uint32_t>(b * kSvgBandRows); r < r1; r++) {
+      const double x = LaneX(layout.lane_of(r));
+      const double y = RowY(r);
+      AppendF(&band.nodes, "<circle cx=\"%.1f\" cy=\"%.1f\" r=\"%g\"/>\n", x,
+              y, rs::kNodeRadius);
+      if (!options.labels) continue;
+      const RowSpan refs = log.refs(r);
+      AppendF(&band.labels, "<text x=\"%.1f\" y=\"%.1f\">", x + 10, y + 4);
+      AppendXmlEscaped(&band.labels, log.id(r).substr(0, 7));
+      if (!refs.empty()) {
+        band.labels.append(" [");
+        AppendXmlEscaped(&band.labels, log.string(refs[0]));
+        band.labels.push_back(']');
+      }
+      band.labels.append("</text>\n");
+    }
+  });
+
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (f == nullptr) {
+    *error = "cannot write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  const double width = (layout.max_lane() + 1) * rs::kLaneWidth +
+                       (options.labels ? kLabelMargin : 0);
+  const double height = std::max(n, 1u) * rs::kRowHeight;
+  std::string head;
+  AppendF(&head,
+          "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%.0f\" "
+          "height=\"%.0f\" viewBox=\"0 0 %.0f %.0f\">\n"
+          "<rect width=\"100%%\" height=\"100%%\" fill=\"#%06x\"/>\n"
+          "<g fill=\"none\" stroke-width=\"%g\">\n",
+          std::ceil(width * options.scale), std::ceil(height * options.scale),
+          width, height, rs::kBackground, rs::kEdgeWidth);
+  bool ok = WriteAll(f, head);
+  for (const auto& band : out) ok = ok && WriteAll(f, band.edges);
+  std::string mid;
+  AppendF(&mid, "</g>\n<g fill=\"#%06x\">\n", rs::kNodeColor);
+  ok = ok && WriteAll(f, mid);
+  for (const auto& band : out) ok = ok && WriteAll(f, band.nodes);
+  std::string labels;
+  AppendF(&labels,
+          "</g>\n<g font-family=\"sans-serif\" font-size=\"12\" "
+          "fill=\"#%06x\">\n",
+          rs::kLabelColor);
+  ok = ok && WriteAll(f, labels);
+  for (const auto& band : out) ok = ok && WriteAll(f, band.labels);
+  ok = ok && WriteAll(f, "</g>\n</svg>\n");
+  if (std::fclose(f) != 0) ok = false;
+  if (!ok) {
+    *error = "cannot write " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
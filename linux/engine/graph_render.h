@@ -0,0 +1,66 @@
+#ifndef ENGINE_GRAPH_RENDER_H_
+#define ENGINE_GRAPH_RENDER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "commit_log.h"
+#include "history_window.h"
+
+class ThreadPool;
+
+// Drawing constants shared with GraphPainter / PagedGraphPainter in
+// frontend/lib/main.dart. Edges are routed as PagedGraphPainter routes them,
+// so exports match the paged viewer rather than the full-graph one.
+namespace render_style {
+
+constexpr double kLaneWidth = 80;
+constexpr double kRowHeight = 50;
+constexpr double kNodeRadius = 6;
+constexpr double kEdgeWidth = 2;
+constexpr uint32_t kNodeColor = 0x1976D2;
+constexpr uint32_t kBackground = 0xFFFFFF;
+constexpr uint32_t kLabelColor = 0x000000;
+constexpr uint32_t kLanePalette[] = {
+    0x1976D2, 0x2E7D32, 0x8E24AA, 0xD81B60, 0x00838F,
+    0x5D4037, 0x3949AB, 0xF9A825, 0x6D4C41, 0x1E88E5,
+};
+
+}  // namespace render_style
+
+struct RenderOptions {
+  // Output pixels per layout unit; 0.1 turns a 500k-commit history into a
+  // 2.5M pixel tall strip.
+  double scale = 1.0;
+  // Maximum pixel rows per PNG tile. Tiles are rasterized and compressed
+  // independently, one per pool task.
+  uint32_t tile_height = 8192;
+  // zlib level for PNG tiles; the mostly white canvas compresses well even
+  // at the fastest setting.
+  int compression = 1;
+  // SVG only: short id and first ref next to each node.
+  bool labels = true;
+};
+
+// Rasterizes the graph into PNG tiles named after |path| ("graph.png", or
+// "graph-0000.png", "graph-0001.png", ... when more than one tile is
+// needed) and appends the written file names to |files|.
+bool WritePngTiles(const CommitLog& log,
+                   const HistoryLayout& layout,
+                   const RenderOptions& options,
+                   ThreadPool* pool,
+                   const std::string& path,
+                   std::vector<std::string>* files,
+                   std::string* error);
+
+// Writes the graph as a single SVG document. Row bands are serialized in
+// parallel and concatenated in order.
+bool WriteSvg(const CommitLog& log,
+              const HistoryLayout& layout,
+              const RenderOptions& options,
+              ThreadPool* pool,
+              const std::string& path,
+              std::string* error);
+
+#endif  // ENGINE_GRAPH_RENDER_H_
@@ -0,0 +1,120 @@
+#include "history_window.h"
+
+#include <algorithm>
+
+#include "json_writer.h"
+
+HistoryLayout::HistoryLayout(const CommitLog& log) : log_(log) {
+  const uint32_t n = log.size();
+  lane_of_.resize(n);
+  checkpoints_.reserve(n / kCheckpointInterval + 1);
+  std::vector<uint32_t> lanes;
+  for (uint32_t row = 0; row < n; row++) {
+    if (row % kCheckpointInterval == 0) checkpoints_.push_back(lanes);
+    const int32_t lane = Advance(log.parents(row), row, &lanes);
+    lane_of_[row] = lane;
+    // Lanes reserved for merge parents are drawn too, so count them.
+    max_lane_ = std::max({max_lane_, lane,
+                          static_cast<int32_t>(lanes.size()) - 1});
+  }
+}
+
+std::vector<uint32_t> HistoryLayout::LaneStateAt(uint32_t row) const {
+  if (row >= size()) row = size();
+  if (checkpoints_.empty()) return {};
+  const uint32_t cp = std::min<uint32_t>(row / kCheckpointInterval,
+                                         checkpoints_.size() - 1);
+  std::vector<uint32_t> lanes = checkpoints_[cp];
+  for (uint32_t r = cp * kCheckpointInterval; r < row; r++) {
+    Advance(log_.parents(r), r, &lanes);
+  }
+  return lanes;
+}
+
+int32_t HistoryLayout::Advance(RowSpan parents,
+                               uint32_t row,
+                               std::vector<uint32_t>* lanes) {
+  std::vector<uint32_t>& l = *lanes;
+  int32_t lane = -1;
+  for (size_t i = 0; i < l.size(); i++) {
+    if (l[i] != row) continue;
+    if (lane < 0) {
+      lane = static_cast<int32_t>(i);
+    } else {
+      // Another branch converging on this commit ends here.
+      l[i] = kNoCommit;
+    }
+  }
+  auto first_free = [&l](int32_t skip) {
+    for (size_t i = 0; i < l.size(); i++) {
+      if (l[i] == kNoCommit && static_cast<int32_t>(i) != skip) {
+        return static_cast<int32_t>(i);
+      }
+    }
+    l.push_back(kNoCommit);
+    return static_cast<int32_t>(l.size() - 1);
+  };
+  if (lane < 0) lane = first_free(-1);
+
+  l[lane] = parents.empty() ? kNoCommit : parents[0];
+  for (size_t i = 1; i < parents.size(); i++) {
+    const uint32_t p = parents[i];
+    if (p == kNoCommit) continue;
+    if (std::find(l.begin(), l.end(), p) != l.end()) continue;
+    l[first_free(lane)] = p;
+  }
+  while (!l.empty() && l.back() == kNoCommit) l.pop_back();
+  return lane;
+}
+
+std::string HistoryWindowJson(const CommitLog& log,
+                              const HistoryLayout& layout,
+                              uint32_t start,
+                              uint32_t count) {
+  const uint32_t total = layout.size();
+  if (start > total) start = total;
+  const uint32_t end = total - start < count ? total : start + count;
+
+  JsonWriter w;
+  w.BeginObject();
+  w.Key("total").Int(total);
+  w.Key("start").Int(start);
+  w.Key("maxLane").Int(layout.max_lane());
+  w.Key("checkpointInterval").Int(kCheckpointInterval);
+  w.Key("lanes").BeginArray();
+  for (uint32_t waiting : layout.LaneStateAt(start)) {
+    if (waiting == kNoCommit) {
+      w.Null();
+    } else {
+      w.String(log.id(waiting));
+    }
+  }
+  w.EndArray();
+  w.Key("rows").BeginArray();
+  for (uint32_t row = start; row < end; row++) {
+    const RowSpan parents = log.parents(row);
+    w.BeginObject();
+    w.Key("row").Int(row);
+    w.Key("lane").Int(layout.lane_of(row));
+    w.Key("id").String(log.id(row));
+    w.Key("parents").BeginArray();
+    for (size_t i = 0; i < parents.size(); i++) w.String(log.parent_id(row, i));
+    w.EndArray();
+    w.Key("parentRows").BeginArray();
+    for (uint32_t p : parents) w.Int(p == kNoCommit ? -1 : p);
+    w.EndArray();
+    w.Key("parentLanes").BeginArray();
+    for (uint32_t p : parents) w.Int(p == kNoCommit ? -1 : layout.lane_of(p));
+    w.EndArray();
+    w.Key("refs").BeginArray();
+    for (uint32_t r : log.refs(row)) w.String(log.string(r));
+    w.EndArray();
+    w.Key("author").String(log.author(row));
+    w.Key("date").String(log.date(row));
+    w.Key("subject").String(log.subject(row));
+    w.EndObject();
+  }
+  w.EndArray();
+  w.EndObject();
+  return w.Take();
+}
@@ -0,0 +1,50 @@
+#ifndef ENGINE_HISTORY_WINDOW_H_
+#define ENGINE_HISTORY_WINDOW_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "commit_log.h"
+
+// Rows between two saved lane states. Restoring the state at an arbitrary
+// row replays at most this many rows.
+constexpr uint32_t kCheckpointInterval = 4096;
+
+// Lane assignment for a topo-ordered history. A lane is reserved for the
+// parent it is waiting for; a commit takes the leftmost lane waiting for it
+// (or the first free lane) and hands that lane on to its first parent.
+class HistoryLayout {
+ public:
+  explicit HistoryLayout(const CommitLog& log);
+
+  uint32_t size() const { return static_cast<uint32_t>(lane_of_.size()); }
+  int32_t lane_of(uint32_t row) const { return lane_of_[row]; }
+  int32_t max_lane() const { return max_lane_; }
+
+  // Lane state just before |row| is placed: entry i is the row lane i is
+  // waiting for, or kNoCommit when the lane is free.
+  std::vector<uint32_t> LaneStateAt(uint32_t row) const;
+
+  // Places |row|, whose parents are |parents|, into |lanes| and returns the
+  // lane it was given. Replaying it from an empty state at row 0 yields
+  // the state LaneStateAt() restores from the nearest checkpoint.
+  static int32_t Advance(RowSpan parents,
+                         uint32_t row,
+                         std::vector<uint32_t>* lanes);
+
+ private:
+  const CommitLog& log_;
+  std::vector<int32_t> lane_of_;
+  std::vector<std::vector<uint32_t>> checkpoints_;
+  int32_t max_lane_ = 0;
+};
+
+// Serializes rows [start, start + count) together with the lane state at
+// |start| for the /graph/window endpoint.
+std::string HistoryWindowJson(const CommitLog& log,
+                              const HistoryLayout& layout,
+                              uint32_t start,
+                              uint32_t count);
+
+#endif  // ENGINE_HISTORY_WINDOW_H_
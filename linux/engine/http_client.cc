@@ -0,0 +1,292 @@
+#include "http_client.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kReadChunk = 64 * 1024;
+
+std::string Lower(std::string s) {
+  for (char& c : s) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+  }
+  return s;
+}
+
+std::string TrimSpaces(const std::string& s) {
+  size_t b = 0;
+  size_t e = s.size();
+  while (b < e && (s[b] == ' ' || s[b] == '\t')) b++;
+  while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t')) e--;
+  return s.substr(b, e - b);
+}
+
+}  // namespace
+
+bool ParseHttpUrl(const std::string& url,
+                  HttpEndpoint* out,
+                  std::string* error) {
+  const std::string scheme = "http://";
+  if (url.compare(0, scheme.size(), scheme) != 0) {
+    *error = "only http:// URLs are supported: " + url;
+    return false;
+  }
+  std::string rest = url.substr(scheme.size());
+  while (!rest.empty() && rest.back() == '/') rest.pop_back();
+  if (rest.empty() || rest.find('/') != std::string::npos) {
+    *error = "expected http://host[:port]: " + url;
+    return false;
+  }
+  const size_t colon = rest.rfind(':');
+  out->host = rest.substr(0, colon);
+  out->port = 80;
+  if (colon != std::string::npos) {
+    char* end = nullptr;
+    const long port = std::strtol(rest.c_str() + colon + 1, &end, 10);
+    if (*end != 0 || port <= 0 || port > 65535) {
+      *error = "invalid port in " + url;
+      return false;
+    }
+    out->port = static_cast<int>(port);
+  }
+  if (out->host.empty()) {
+    *error = "missing host in " + url;
+    return false;
+  }
+  return true;
+}
+
+HttpConnection::HttpConnection(const HttpEndpoint& endpoint, int timeout_ms)
+    : endpoint_(endpoint), timeout_ms_(timeout_ms) {}
+
+HttpConnection::~HttpConnection() {
+  Close();
+}
+
+bool HttpConnection::Connect(std::string* error) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addrs = nullptr;
+  const std::string port = std::to_string(endpoint_.port);
+  const int rc =
+      getaddrinfo(endpoint_.host.c_str(), port.c_str(), &hints, &addrs);
+  if (rc != 0) {
+    *error = endpoint_.host + ": " + gai_strerror(rc);
+    return false;
+  }
+  std::string last_error = "no address";
+  for (addrinfo* a = addrs; a != nullptr; a = a->ai_next) {
+    const int fd =
+        socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+    if (fd < 0) {
+      last_error = std::strerror(errno);
+      continue;
+    }
+    if (connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+      last_error = std::strerror(errno);
+      close(fd);
+      continue;
+    }
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    timeval tv;
+    tv.tv_sec = timeout_ms_ / 1000;
+    tv.tv_usec = (timeout_ms_ % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    fd_ = fd;
+    break;
+  }
+  freeaddrinfo(addrs);
+  if (fd_ < 0) {
+    *error = "cannot connect to " + endpoint_.host + ":" + port + ": " +
+             last_error;
+    return false;
+  }
+  buffer_.clear();
+  read_pos_ = 0;
+  return true;
+}
+
+void HttpConnection::Close() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  buffer_.clear();
+  read_pos_ = 0;
+}
+
+bool HttpConnection::SendAll(const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const ssize_t n =
+        send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool HttpConnection::Fill(size_t size) {
+  char chunk[kReadChunk];
+  while (buffer_.size() - read_pos_ < size) {
+    const ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    buffer_.append(chunk, static_cast<size_t>(n));
+  }
+  return true;
+}
+
+bool HttpConnection::ReadLine(std::string* line) {
+  size_t end;
+  while ((end = buffer_.find("\r\n", read_pos_)) == std::string::npos) {
+    if (!Fill(buffer_.size() - read_pos_ + 1)) return false;
+  }
+  line->assign(buffer_, read_pos_, end - read_pos_);
+  read_pos_ = end + 2;
+  return true;
+}
+
+bool HttpConnection::ReadResponse(bool keep_body,
+                                  HttpResponse* response,
+                                  bool* reusable,
+                                  std::string* error) {
+  // Moves |size| body bytes out of the socket without holding more than a
+  // read chunk at a time unless the caller wants the body.
+  auto drain = [&](size_t size) {
+    while (size > 0) {
+      if (read_pos_ == buffer_.size()) {
+        buffer_.clear();
+        read_pos_ = 0;
+        if (!Fill(1)) return false;
+      }
+      const size_t take = std::min(size, buffer_.size() - read_pos_);
+      if (keep_body) response->body.append(buffer_, read_pos_, take);
+      response->body_bytes += take;
+      read_pos_ += take;
+      size -= take;
+    }
+    return true;
+  };
+
+  std::string line;
+  if (!ReadLine(&line)) {
+    *error = "connection closed before a response";
+    return false;
+  }
+  // "HTTP/1.1 200 OK"
+  const size_t sp = line.find(' ');
+  if (line.compare(0, 5, "HTTP/") != 0 || sp == std::string::npos) {
+    *error = "malformed status line: " + line;
+    return false;
+  }
+  response->status = std::atoi(line.c_str() + sp + 1);
+  *reusable = line.compare(0, 8, "HTTP/1.0") != 0;
+
+  bool chunked = false;
+  bool has_length = false;
+  size_t length = 0;
+  for (;;) {
+    if (!ReadLine(&line)) {
+      *error = "connection closed in headers";
+      return false;
+    }
+    if (line.empty()) break;
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    const std::string name = Lower(line.substr(0, colon));
+    const std::string value = Lower(TrimSpaces(line.substr(colon + 1)));
+    if (name == "content-length") {
+      has_length = true;
+      length = static_cast<size_t>(std::strtoull(value.c_str(), nullptr, 10));
+    } else if (name == "transfer-encoding") {
+      chunked = value.find("chunked") != std::string::npos;
+    } else if (name == "connection") {
+      if (value == "close") *reusable = false;
+      if (value == "keep-alive") *reusable = true;
+    }
+  }
+
+  if (chunked) {
+    for (;;) {
+      if (!ReadLine(&line)) {
+        *error = "connection closed in chunked body";
+        return false;
+      }
+      const size_t size =
+          static_cast<size_t>(std::strtoull(line.c_str(), nullptr, 16));
+      if (size == 0) break;
+      if (!drain(size) || !ReadLine(&line)) {
+        *error = "connection closed in chunked body";
+        return false;
+      }
+    }
+    // Trailer fields, up to the blank line.
+    do {
+      if (!ReadLine(&line)) {
+        *error = "connection closed in chunked trailer";
+        return false;
+      }
+    } while (!line.empty());
+  } else if (has_length) {
+    if (!drain(length)) {
+      *error = "connection closed in body";
+      return false;
+    }
+  } else {
+    // Body runs to the end of the connection.
+    while (drain(buffer_.size() - read_pos_) && Fill(1)) {
+    }
+    drain(buffer_.size() - read_pos_);
+    *reusable = false;
+  }
+  return true;
+}
+
+bool HttpConnection::Request(const char* method,
+                             const std::string& path,
+                             const std::string& body,
+                             bool keep_body,
+                             HttpResponse* response,
+                             std::string* error) {
+  std::string request = std::string(method) + " " + path + " HTTP/1.1\r\n";
+  request += "Host: " + endpoint_.host + ":" +
+             std::to_string(endpoint_.port) + "\r\n";
+  request += "Content-Type: application/json\r\n";
+  request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+  request += "Connection: keep-alive\r\n\r\n";
+  request += body;
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    const bool reused = fd_ >= 0;
+    if (fd_ < 0 && !Connect(error)) return false;
+    buffer_.erase(0, read_pos_);
+    read_pos_ = 0;
+    *response = HttpResponse();
+    bool reusable = false;
+    if (!SendAll(request)) {
+      *error = std::string("send: ") + std::strerror(errno);
+    } else if (ReadResponse(keep_body, response, &reusable, error)) {
+      if (!reusable) Close();
+      return true;
+    }
+    const bool got_bytes = response->status != 0;
+    Close();
+    // Only an idle connection the server dropped is worth a retry; a
+    // request that failed half way is reported.
+    if (!reused || got_bytes) break;
+  }
+  return false;
+}
@@ -0,0 +1,61 @@
+#ifndef ENGINE_HTTP_CLIENT_H_
+#define ENGINE_HTTP_CLIENT_H_
+
+#include <cstddef>
+#include <string>
+
+// Host and port of an "http://host:port" base URL. Paths and https are not
+// supported; the load tester only talks to a local server.
+struct HttpEndpoint {
+  std::string host;
+  int port = 80;
+};
+
+bool ParseHttpUrl(const std::string& url,
+                  HttpEndpoint* out,
+                  std::string* error);
+
+struct HttpResponse {
+  int status = 0;
+  size_t body_bytes = 0;
+  // Kept only when the caller asks for it.
+  std::string body;
+};
+
+// One blocking HTTP/1.1 keep-alive connection. Not thread-safe; each load
+// worker owns its own.
+class HttpConnection {
+ public:
+  HttpConnection(const HttpEndpoint& endpoint, int timeout_ms);
+  ~HttpConnection();
+  HttpConnection(const HttpConnection&) = delete;
+  HttpConnection& operator=(const HttpConnection&) = delete;
+
+  // Sends one request and reads the whole response. A keep-alive
+  // connection the server has already closed is reopened and the request
+  // retried once.
+  bool Request(const char* method,
+               const std::string& path,
+               const std::string& body,
+               bool keep_body,
+               HttpResponse* response,
+               std::string* error);
+
+ private:
+  bool Connect(std::string* error);
+  void Close();
+  bool SendAll(const std::string& data);
+  // Reads until |buffer_| holds at least |size| bytes; false on EOF/error.
+  bool Fill(size_t size);
+  bool ReadLine(std::string* line);
+  bool ReadResponse(bool keep_body, HttpResponse* response, bool* reusable,
+                    std::string* error);
+
+  HttpEndpoint endpoint_;
+  int timeout_ms_;
+  int fd_ = -1;
+  std::string buffer_;
+  size_t read_pos_ = 0;
+};
+
+#endif  // ENGINE_HTTP_CLIENT_H_
@@ -0,0 +1,44 @@
+#ifndef ENGINE_JSON_WRITER_H_
+#define ENGINE_JSON_WRITER_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal streaming JSON builder used to hand results across the FFI
+// boundary. Commas between members and elements are inserted automatically.
+class JsonWriter {
+ public:
+  JsonWriter& BeginObject();
+  JsonWriter& EndObject();
+  JsonWriter& BeginArray();
+  JsonWriter& EndArray();
+
+  // Writes an object member name; the next value written becomes its value.
+  JsonWriter& Key(const std::string& key);
+
+  JsonWriter& String(std::string_view value);
+  JsonWriter& String(const char* data, size_t size);
+  JsonWriter& Int(int64_t value);
+  JsonWriter& Double(double value);
+  JsonWriter& Bool(bool value);
+  JsonWriter& Null();
+
+  const std::string& str() const { return out_; }
+  std::string Take() { return std::move(out_); }
+
+ private:
+  void BeforeValue();
+  void AppendQuoted(const char* data, size_t size);
+
+  std::string out_;
+  // One entry per open container: true once it holds at least one value.
+  std::vector<bool> has_items_;
+  bool after_key_ = false;
+};
+
+// Convenience for the common `{"error": "..."}` result.
+std::string JsonError(const std::string& message);
+
+#endif  // ENGINE_JSON_WRITER_H_
@@ -0,0 +1,533 @@
+#include "load_test.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "git_process.h"
+#include "json_writer.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kTagInterval = 1000;
+constexpr const char* kEndpointNames[kEndpointCount] = {"graph", "branches",
+                                                        "reset"};
+constexpr const char* kEndpointPaths[kEndpointCount] = {"/graph", "/branches",
+                                                        "/reset"};
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool MakeDirs(const std::string& path, std::string* error) {
+  for (size_t i = 1; i <= path.size(); i++) {
+    if (i < path.size() && path[i] != '/') continue;
+    const std::string prefix = path.substr(0, i);
+    if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+      *error = "cannot create " + prefix + ": " + std::strerror(errno);
+      return false;
+    }
+  }
+  return true;
+}
+
+// fast-import stream for |spec|: branch 0 is main and takes about half of
+// the commits; the others fork from main, keep committing, and are merged
+// back from time to time, which gives the graph long-lived lanes.
+std::string FixtureStream(const FixtureSpec& spec) {
+  static const char* const kAuthors[] = {"Alice", "Bob",  "Carol", "Dmitri",
+                                         "Eve",   "张三", "李四",  "Mallory"};
+  static const char* const kVerbs[] = {"Fix",    "Add",    "Refactor",
+                                       "Update", "Remove", "Document"};
+  static const char* const kAreas[] = {"parser", "renderer", "server",
+                                       "lanes",  "search",   "backup"};
+  std::mt19937 rng(spec.commits * 31 + spec.branches);
+  const uint32_t branches = std::max<uint32_t>(spec.branches, 1);
+  std::vector<uint32_t> heads(branches, 0);
+  std::vector<uint32_t> merged(branches, 0);
+  std::string out;
+  char line[256];
+  for (uint32_t i = 1; i <= spec.commits; i++) {
+    uint32_t b = rng() % (2 * branches);
+    if (b >= branches || heads[0] == 0) b = 0;
+    const std::string ref = b == 0 ? "main" : "topic-" + std::to_string(b);
+    const char* author = kAuthors[i % 8];
+    std::snprintf(line, sizeof(line), "%s %s handling for case %u\n",
+                  kVerbs[i % 6], kAreas[(i / 6) % 6], i);
+    const std::string message = line;
+    out += "commit refs/heads/" + ref + "\nmark :" + std::to_string(i) + "\n";
+    std::snprintf(line, sizeof(line),
+                  "author %s <dev%u@example.com> %u +0800\n"
+                  "committer %s <dev%u@example.com> %u +0800\n",
+                  author, i % 8, 1600000000u + i * 600, author, i % 8,
+                  1600000000u + i * 600);
+    out += line;
+    out += "data " + std::to_string(message.size()) + "\n" + message;
+    const uint32_t from = heads[b] != 0 ? heads[b] : heads[0];
+    if (from != 0) out += "from :" + std::to_string(from) + "\n";
+    if (b == 0 && rng() % 4 == 0) {
+      const uint32_t other = 1 + rng() % branches;
+      if (other < branches && heads[other] != 0 &&
+          merged[other] != heads[other]) {
+        out += "merge :" + std::to_string(heads[other]) + "\n";
+        merged[other] = heads[other];
+      }
+    }
+    const std::string content = std::to_string(i) + "\n";
+    out += "M 644 inline src/" + ref + ".txt\ndata " +
+           std::to_string(content.size()) + "\n" + content + "\n";
+    heads[b] = i;
+  }
+  for (uint32_t i = kTagInterval; i <= spec.commits; i += kTagInterval) {
+    out += "reset refs/tags/v" + std::to_string(i / kTagInterval) +
+           "\nfrom :" + std::to_string(i) + "\n\n";
+  }
+  return out;
+}
+
+// Runs `git -C <repo> fast-import --quiet` with |stream_path| as stdin.
+bool FastImport(const std::string& repo,
+                const std::string& stream_path,
+                std::string* error) {
+  const int in = open(stream_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (in < 0) {
+    *error = "cannot read " + stream_path + ": " + std::strerror(errno);
+    return false;
+  }
+  const pid_t pid = fork();
+  if (pid < 0) {
+    *error = std::string("fork: ") + std::strerror(errno);
+    close(in);
+    return false;
+  }
+  if (pid == 0) {
+    dup2(in, STDIN_FILENO);
+    execlp("git", "git", "-C", repo.c_str(), "fast-import", "--quiet",
+           static_cast<char*>(nullptr));
+    _exit(127);
+  }
+  close(in);
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    *error = "git fast-import failed in " + repo;
+    return false;
+  }
+  return true;
+}
+
+double Percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+  rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+  return sorted[rank - 1];
+}
+
+void Summarize(std::vector<double>* latencies,
+               uint64_t errors,
+               LatencySummary* out) {
+  std::sort(latencies->begin(), latencies->end());
+  out->requests = latencies->size() + errors;
+  out->errors = errors;
+  out->p50_ms = Percentile(*latencies, 0.50);
+  out->p95_ms = Percentile(*latencies, 0.95);
+  out->p99_ms = Percentile(*latencies, 0.99);
+  out->max_ms = latencies->empty() ? 0 : latencies->back();
+}
+
+std::string RequestBody(size_t endpoint,
+                        const std::string& repo,
+                        int64_t graph_limit) {
+  if (endpoint == kResetEndpoint) return "{}";
+  JsonWriter w;
+  w.BeginObject();
+  w.Key("repoPath").String(repo);
+  if (endpoint == kGraphEndpoint && graph_limit > 0) {
+    w.Key("limit").Int(graph_limit);
+  }
+  w.EndObject();
+  return w.Take();
+}
+
+void WriteSummary(JsonWriter* w, const LatencySummary& s, double elapsed) {
+  w->BeginObject();
+  w->Key("requests").Int(static_cast<int64_t>(s.requests));
+  w->Key("errors").Int(static_cast<int64_t>(s.errors));
+  w->Key("requestsPerSecond")
+      .Double(elapsed > 0 ? (s.requests - s.errors) / elapsed : 0);
+  w->Key("p50Ms").Double(s.p50_ms);
+  w->Key("p95Ms").Double(s.p95_ms);
+  w->Key("p99Ms").Double(s.p99_ms);
+  w->Key("maxMs").Double(s.max_ms);
+  w->EndObject();
+}
+
+}  // namespace
+
+bool EnsureFixture(const std::string& root,
+                   const FixtureSpec& spec,
+                   std::string* path,
+                   std::string* error) {
+  *path = root + "/fixture-" + std::to_string(spec.commits) + "x" +
+          std::to_string(spec.branches);
+  struct stat st;
+  if (stat((*path + "/.git").c_str(), &st) == 0) {
+    std::vector<std::string> lines;
+    std::string ignored;
+    if (RunGitLines(*path, {"rev-list", "--count", "--all"}, &lines,
+                    &ignored) &&
+        lines.size() == 1 && lines[0] == std::to_string(spec.commits)) {
+      return true;
+    }
+    *error = *path + " exists but is not a complete fixture; remove it";
+    return false;
+  }
+  if (!MakeDirs(*path, error)) return false;
+  std::vector<std::string> ignored_lines;
+  if (!RunGitLines(*path, {"init", "-q"}, &ignored_lines, error)) return false;
+
+  const std::string stream_path = *path + "/.git/fixture.stream";
+  {
+    std::ofstream stream(stream_path, std::ios::binary);
+    stream << FixtureStream(spec);
+    if (!stream) {
+      *error = "cannot write " + stream_path;
+      return false;
+    }
+  }
+  const bool ok = FastImport(*path, stream_path, error);
+  std::remove(stream_path.c_str());
+  if (!ok) return false;
+  return RunGitLines(*path, {"symbolic-ref", "HEAD", "refs/heads/main"},
+                     &ignored_lines, error);
+}
+
+const char* LoadEndpointName(size_t endpoint) {
+  return endpoint < kEndpointCount ? kEndpointNames[endpoint] : "?";
+}
+
+bool ParseLoadMix(const std::string& spec,
+                  double weights[kEndpointCount],
+                  std::string* error) {
+  std::fill(weights, weights + kEndpointCount, 0.0);
+  double sum = 0;
+  std::stringstream items(spec);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    const size_t eq = item.find('=');
+    const std::string name = item.substr(0, eq);
+    size_t e = 0;
+    while (e < kEndpointCount && name != kEndpointNames[e]) e++;
+    char* end = nullptr;
+    const double weight =
+        eq == std::string::npos ? -1 : std::strtod(item.c_str() + eq + 1, &end);
+    if (e == kEndpointCount || weight < 0 || end == nullptr || *end != 0) {
+      *error = "invalid mix entry \"" + item +
+               "\"; expected graph=N, branches=N or reset=N";
+      return false;
+    }
+    weights[e] = weight;
+    sum += weight;
+  }
+  if (sum <= 0) {
+    *error = "mix has no positive weight";
+    return false;
+  }
+  return true;
+}
+
+int FindListeningPid(int port) {
+  // Sockets in state 0A (LISTEN) on |port|, by inode.
+  std::vector<std::string> inodes;
+  for (const char* table : {"/proc/net/tcp", "/proc/net/tcp6"}) {
+    std::ifstream in(table);
+    std::string line;
+    std::getline(in, line);  // Header.
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string slot, local, remote, state, queues, timer, retransmit, uid,
+          timeout, inode;
+      fields >> slot >> local >> remote >> state >> queues >> timer >>
+          retransmit >> uid >> timeout >> inode;
+      const size_t colon = local.rfind(':');
+      if (state != "0A" || colon == std::string::npos) continue;
+      if (std::strtol(local.c_str() + colon + 1, nullptr, 16) != port) {
+        continue;
+      }
+      inodes.push_back("socket:[" + inode + "]");
+    }
+  }
+  if (inodes.empty()) return 0;
+
+  DIR* proc = opendir("/proc");
+  if (proc == nullptr) return 0;
+  int found = 0;
+  while (dirent* entry = readdir(proc)) {
+    const int pid = std::atoi(entry->d_name);
+    if (pid <= 0) continue;
+    const std::string fd_dir = std::string("/proc/") + entry->d_name + "/fd";
+    DIR* fds = opendir(fd_dir.c_str());
+    if (fds == nullptr) continue;
+    while (dirent* fd = readdir(fds)) {
+      char target[64];
+      const std::string link = fd_dir + "/" + fd->d_name;
+      const ssize_t n = readlink(link.c_str(), target, sizeof(target) - 1);
+      if (n <= 0) continue;
+      target[n] = 0;
+      if (std::find(inodes.begin(), inodes.end(), target) != inodes.end()) {
+        found = pid;
+        break;
+      }
+    }
+    closedir(fds);
+    if (found != 0) break;
+  }
+  closedir(proc);
+  return found;
+}
+
+int64_t ReadRssKb(int pid) {
+  if (pid <= 0) return -1;
+  std::ifstream in("/proc/" + std::to_string(pid) + "/status");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      return std::strtoll(line.c_str() + 6, nullptr, 10);
+    }
+  }
+  return -1;
+}
+
+bool RunLoad(const LoadOptions& options,
+             const std::function<void(const LoadSample&)>& on_sample,
+             LoadReport* report,
+             std::string* error) {
+  *report = LoadReport();
+  if (options.repos.empty()) {
+    *error = "no repositories to query";
+    return false;
+  }
+  {
+    HttpConnection probe(options.server, options.timeout_ms);
+    HttpResponse response;
+    if (!probe.Request("GET", "/health", "", false, &response, error)) {
+      return false;
+    }
+    if (response.status != 200) {
+      *error = "/health returned " + std::to_string(response.status);
+      return false;
+    }
+  }
+
+  struct Worker {
+    std::vector<double> latencies[kEndpointCount];
+    uint64_t errors[kEndpointCount] = {};
+  };
+  std::vector<Worker> workers(options.concurrency);
+  std::atomic<uint64_t> completed{0};
+  std::atomic<uint64_t> failed{0};
+  std::atomic<bool> stop{false};
+  std::mutex error_mutex;
+
+  report->rss_start_kb = ReadRssKb(options.server_pid);
+  report->rss_peak_kb = report->rss_start_kb;
+  const auto start = Clock::now();
+  const auto deadline =
+      start + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(options.duration_s));
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < options.concurrency; i++) {
+    threads.emplace_back([&, i] {
+      Worker& worker = workers[i];
+      HttpConnection connection(options.server, options.timeout_ms);
+      std::mt19937_64 rng(0x9e3779b97f4a7c15ull * (i + 1));
+      std::discrete_distribution<size_t> pick_endpoint(
+          options.weights, options.weights + kEndpointCount);
+      std::uniform_int_distribution<size_t> pick_repo(
+          0, options.repos.size() - 1);
+      HttpResponse response;
+      std::string request_error;
+      while (!stop.load(std::memory_order_relaxed) &&
+             Clock::now() < deadline) {
+        const size_t endpoint = pick_endpoint(rng);
+        const std::string body = RequestBody(
+            endpoint, options.repos[pick_repo(rng)], options.graph_limit);
+        const auto sent = Clock::now();
+        const bool ok = connection.Request("POST", kEndpointPaths[endpoint],
+                                           body, false, &response,
+                                           &request_error);
+        const double ms =
+            std::chrono::duration<double, std::milli>(Clock::now() - sent)
+                .count();
+        if (ok && response.status >= 200 && response.status < 300) {
+          worker.latencies[endpoint].push_back(ms);
+          completed.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        worker.errors[endpoint]++;
+        failed.fetch_add(1, std::memory_order_relaxed);
+        {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (report->first_error.empty()) {
+            report->first_error =
+                std::string(kEndpointPaths[endpoint]) + ": " +
+                (ok ? "HTTP " + std::to_string(response.status)
+                    : request_error);
+          }
+        }
+        // Do not spin on a server that is down.
+        if (!ok) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    });
+  }
+
+  // Sample the timeline on this thread until the workers are done.
+  uint64_t last_completed = 0;
+  double last_t = 0;
+  for (int tick = 1;; tick++) {
+    const auto next =
+        start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(tick * options.interval_s));
+    std::this_thread::sleep_until(std::min(next, deadline));
+    LoadSample sample;
+    sample.t_s = SecondsSince(start);
+    const uint64_t done = completed.load();
+    const double dt = sample.t_s - last_t;
+    sample.requests_per_s = dt > 0 ? (done - last_completed) / dt : 0;
+    sample.errors = failed.load();
+    sample.rss_kb = ReadRssKb(options.server_pid);
+    report->rss_peak_kb = std::max(report->rss_peak_kb, sample.rss_kb);
+    last_completed = done;
+    last_t = sample.t_s;
+    report->timeline.push_back(sample);
+    if (on_sample) on_sample(sample);
+    if (Clock::now() >= deadline) break;
+  }
+  stop = true;
+  for (auto& t : threads) t.join();
+  report->elapsed_s = SecondsSince(start);
+  report->rss_end_kb = ReadRssKb(options.server_pid);
+  report->rss_peak_kb = std::max(report->rss_peak_kb, report->rss_end_kb);
+
+  std::vector<double> all;
+  uint64_t all_errors = 0;
+  for (size_t e = 0; e < kEndpointCount; e++) {
+    std::vector<double> latencies;
+    uint64_t errors = 0;
+    for (auto& w : workers) {
+      latencies.insert(latencies.end(), w.latencies[e].begin(),
+                       w.latencies[e].end());
+      errors += w.errors[e];
+    }
+    all.insert(all.end(), latencies.begin(), latencies.end());
+    all_errors += errors;
+    Summarize(&latencies, errors, &report->endpoints[e]);
+  }
+  Summarize(&all, all_errors, &report->total);
+  return true;
+}
+
+void PrintLoadReport(const LoadReport& report, FILE* out) {
+  std::fprintf(out, "%-10s %9s %7s %9s %9s %9s %9s %9s\n", "endpoint",
+               "requests", "errors", "req/s", "p50 ms", "p95 ms", "p99 ms",
+               "max ms");
+  auto row = [&](const char* name, const LatencySummary& s) {
+    const double rps =
+        report.elapsed_s > 0 ? (s.requests - s.errors) / report.elapsed_s : 0;
+    std::fprintf(out, "%-10s %9llu %7llu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                 name, static_cast<unsigned long long>(s.requests),
+                 static_cast<unsigned long long>(s.errors), rps, s.p50_ms,
+                 s.p95_ms, s.p99_ms, s.max_ms);
+  };
+  for (size_t e = 0; e < kEndpointCount; e++) {
+    if (report.endpoints[e].requests > 0) {
+      row(kEndpointNames[e], report.endpoints[e]);
+    }
+  }
+  row("total", report.total);
+  if (report.rss_start_kb >= 0) {
+    std::fprintf(out,
+                 "server rss: start %.1f MiB, peak %.1f MiB, end %.1f MiB\n",
+                 report.rss_start_kb / 1024.0, report.rss_peak_kb / 1024.0,
+                 report.rss_end_kb / 1024.0);
+  } else {
+    std::fprintf(out, "server rss: unavailable (pass --pid)\n");
+  }
+  if (!report.first_error.empty()) {
+    std::fprintf(out, "first error: %s\n", report.first_error.c_str());
+  }
+}
+
+std::string LoadReportJson(const LoadOptions& options,
+                           const LoadReport& report) {
+  JsonWriter w;
+  w.BeginObject();
+  w.Key("concurrency").Int(static_cast<int64_t>(options.concurrency));
+  w.Key("elapsedSeconds").Double(report.elapsed_s);
+  w.Key("repos").BeginArray();
+  for (const auto& repo : options.repos) w.String(repo);
+  w.EndArray();
+  w.Key("mix").BeginObject();
+  for (size_t e = 0; e < kEndpointCount; e++) {
+    w.Key(kEndpointNames[e]).Double(options.weights[e]);
+  }
+  w.EndObject();
+  w.Key("endpoints").BeginObject();
+  for (size_t e = 0; e < kEndpointCount; e++) {
+    w.Key(kEndpointNames[e]);
+    WriteSummary(&w, report.endpoints[e], report.elapsed_s);
+  }
+  w.EndObject();
+  w.Key("total");
+  WriteSummary(&w, report.total, report.elapsed_s);
+  w.Key("rssKb").BeginObject();
+  auto kb = [&w](int64_t value) {
+    if (value < 0) {
+      w.Null();
+    } else {
+      w.Int(value);
+    }
+  };
+  w.Key("start");
+  kb(report.rss_start_kb);
+  w.Key("peak");
+  kb(report.rss_peak_kb);
+  w.Key("end");
+  kb(report.rss_end_kb);
+  w.EndObject();
+  w.Key("timeline").BeginArray();
+  for (const auto& s : report.timeline) {
+    w.BeginObject();
+    w.Key("t").Double(s.t_s);
+    w.Key("requestsPerSecond").Double(s.requests_per_s);
+    w.Key("errors").Int(static_cast<int64_t>(s.errors));
+    w.Key("rssKb");
+    kb(s.rss_kb);
+    w.EndObject();
+  }
+  w.EndArray();
+  if (!report.first_error.empty()) {
+    w.Key("firstError").String(report.first_error);
+  }
+  w.EndObject();
+  return w.Take();
+}
@@ -0,0 +1,107 @@
+#ifndef ENGINE_LOAD_TEST_H_
+#define ENGINE_LOAD_TEST_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "http_client.h"
+
+// Shape of a generated fixture repository.
+struct FixtureSpec {
+  uint32_t commits = 2000;
+  uint32_t branches = 8;
+};
+
+// Creates a repository under |root| with |spec.commits| commits spread over
+// |spec.branches| branches that keep merging back into main, plus a tag
+// every 1000 commits, and returns its path. An existing fixture with the
+// same shape is reused.
+bool EnsureFixture(const std::string& root,
+                   const FixtureSpec& spec,
+                   std::string* path,
+                   std::string* error);
+
+// The server endpoints the load tester exercises.
+enum LoadEndpoint : size_t {
+  kGraphEndpoint,
+  kBranchesEndpoint,
+  kResetEndpoint,
+  kEndpointCount,
+};
+
+const char* LoadEndpointName(size_t endpoint);
+
+// Parses "graph=6,branches=3,reset=1" into relative weights. Endpoints not
+// listed get weight 0.
+bool ParseLoadMix(const std::string& spec,
+                  double weights[kEndpointCount],
+                  std::string* error);
+
+struct LoadOptions {
+  HttpEndpoint server;
+  std::vector<std::string> repos;
+  double weights[kEndpointCount] = {6, 3, 1};
+  // Sent as /graph's "limit" when positive.
+  int64_t graph_limit = 0;
+  size_t concurrency = 8;
+  double duration_s = 30;
+  double interval_s = 1;
+  int timeout_ms = 60000;
+  // Process whose RSS is sampled; 0 disables sampling.
+  int server_pid = 0;
+};
+
+// Successful (2xx) response latencies of one endpoint.
+struct LatencySummary {
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+  double p50_ms = 0;
+  double p95_ms = 0;
+  double p99_ms = 0;
+  double max_ms = 0;
+};
+
+struct LoadSample {
+  double t_s = 0;
+  double requests_per_s = 0;
+  uint64_t errors = 0;
+  int64_t rss_kb = -1;
+};
+
+struct LoadReport {
+  double elapsed_s = 0;
+  LatencySummary endpoints[kEndpointCount];
+  LatencySummary total;
+  std::vector<LoadSample> timeline;
+  // -1 when the server's RSS could not be read.
+  int64_t rss_start_kb = -1;
+  int64_t rss_peak_kb = -1;
+  int64_t rss_end_kb = -1;
+  std::string first_error;
+};
+
+// Runs |options.concurrency| keep-alive clients against the server for
+// |options.duration_s| seconds, each picking an endpoint by weight and a
+// repository at random for every request. |on_sample| sees each timeline
+// sample as it is taken. Fails only when the server is unreachable at the
+// start; request errors are counted in the report.
+bool RunLoad(const LoadOptions& options,
+             const std::function<void(const LoadSample&)>& on_sample,
+             LoadReport* report,
+             std::string* error);
+
+// Owner of the socket listening on TCP |port|, found through /proc/net/tcp
+// and /proc/<pid>/fd; 0 when there is none or it is not visible to us.
+int FindListeningPid(int port);
+
+// VmRSS of |pid| in KiB, or -1.
+int64_t ReadRssKb(int pid);
+
+void PrintLoadReport(const LoadReport& report, FILE* out);
+std::string LoadReportJson(const LoadOptions& options,
+                           const LoadReport& report);
+
+#endif  // ENGINE_LOAD_TEST_H_
@@ -0,0 +1,173 @@
+// gitgraph_loadtest: drives a running Dart server with a concurrent mix of
+// /graph, /branches and /reset requests against generated fixture
+// repositories, and reports throughput, latency percentiles and the
+// server's RSS over time.
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cli_args.h"
+#include "load_test.h"
+
+namespace {
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "usage: gitgraph_loadtest [options]\n"
+      "  --url URL             server base URL\n"
+      "                        (default http://127.0.0.1:8080)\n"
+      "  --repo PATH           query this repository (repeatable); replaces\n"
+      "                        the generated fixtures\n"
+      "  --fixtures N,N,...    commit counts of the fixtures to generate\n"
+      "                        (default 2000,20000)\n"
+      "  --branches N          branches per fixture (default 8)\n"
+      "  --fixture-dir DIR     where fixtures live (default\n"
+      "                        /tmp/gitgraph-loadtest)\n"
+      "  --mix SPEC            endpoint weights (default "
+      "graph=6,branches=3,reset=1)\n"
+      "  --graph-limit N       \"limit\" sent with /graph (default: none)\n"
+      "  --concurrency N       concurrent connections (default 8)\n"
+      "  --duration S          seconds to run (default 30)\n"
+      "  --interval S          seconds between timeline samples (default 1)\n"
+      "  --timeout S           per-request timeout (default 60)\n"
+      "  --pid PID             server process to sample RSS from (default:\n"
+      "                        the process listening on the URL's port)\n"
+      "  --json                print the summary as JSON on stdout\n");
+}
+
+bool ParseCounts(const std::string& spec, std::vector<uint32_t>* out) {
+  std::stringstream items(spec);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    int64_t value;
+    if (!ParseIntArg(item.c_str(), 1, UINT32_MAX, &value)) return false;
+    out->push_back(static_cast<uint32_t>(value));
+  }
+  return !out->empty();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  LoadOptions options;
+  std::string url = "http://127.0.0.1:8080";
+  std::string fixture_dir = "/tmp/gitgraph-loadtest";
+  std::string mix;
+  std::vector<uint32_t> fixtures;
+  FixtureSpec spec;
+  bool json = false;
+  bool usage_error = false;
+  int64_t value = 0;
+  double seconds = 0;
+
+  for (int i = 1; i < argc && !usage_error; i++) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--url" && has_value) {
+      url = argv[++i];
+    } else if (arg == "--repo" && has_value) {
+      options.repos.push_back(argv[++i]);
+    } else if (arg == "--fixtures" && has_value) {
+      usage_error = !ParseCounts(argv[++i], &fixtures);
+    } else if (arg == "--branches" && has_value) {
+      usage_error = !ParseIntArg(argv[++i], 1, 4096, &value);
+      spec.branches = static_cast<uint32_t>(value);
+    } else if (arg == "--fixture-dir" && has_value) {
+      fixture_dir = argv[++i];
+    } else if (arg == "--mix" && has_value) {
+      mix = argv[++i];
+    } else if (arg == "--graph-limit" && has_value) {
+      usage_error =
+          !ParseIntArg(argv[++i], 1, INT64_MAX, &options.graph_limit);
+    } else if (arg == "--concurrency" && has_value) {
+      usage_error = !ParseIntArg(argv[++i], 1, 4096, &value);
+      options.concurrency = static_cast<size_t>(value);
+    } else if (arg == "--duration" && has_value) {
+      usage_error = !ParseDoubleArg(argv[++i], 0, 1e9, &options.duration_s) ||
+                    options.duration_s == 0;
+    } else if (arg == "--interval" && has_value) {
+      usage_error = !ParseDoubleArg(argv[++i], 0.05, 1e9, &options.interval_s);
+    } else if (arg == "--timeout" && has_value) {
+      usage_error = !ParseDoubleArg(argv[++i], 0.001, 1e6, &seconds);
+      options.timeout_ms = static_cast<int>(seconds * 1000);
+    } else if (arg == "--pid" && has_value) {
+      usage_error = !ParseIntArg(argv[++i], 1, INT32_MAX, &value);
+      options.server_pid = static_cast<int>(value);
+    } else if (arg == "--json") {
+      json = true;
+    } else if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else {
+      usage_error = true;
+    }
+  }
+  std::string error;
+  if (!usage_error && !ParseHttpUrl(url, &options.server, &error)) {
+    std::fprintf(stderr, "gitgraph_loadtest: %s\n", error.c_str());
+    usage_error = true;
+  }
+  if (!usage_error && !mix.empty() &&
+      !ParseLoadMix(mix, options.weights, &error)) {
+    std::fprintf(stderr, "gitgraph_loadtest: %s\n", error.c_str());
+    usage_error = true;
+  }
+  if (usage_error) {
+    PrintUsage();
+    return 2;
+  }
+
+  if (options.repos.empty()) {
+    if (fixtures.empty()) fixtures = {2000, 20000};
+    for (uint32_t commits : fixtures) {
+      spec.commits = commits;
+      std::string path;
+      std::fprintf(stderr, "fixture %u commits x %u branches... ", commits,
+                   spec.branches);
+      if (!EnsureFixture(fixture_dir, spec, &path, &error)) {
+        std::fprintf(stderr, "\ngitgraph_loadtest: %s\n", error.c_str());
+        return 1;
+      }
+      std::fprintf(stderr, "%s\n", path.c_str());
+      options.repos.push_back(path);
+    }
+  }
+  if (options.server_pid == 0) {
+    options.server_pid = FindListeningPid(options.server.port);
+  }
+  if (options.server_pid != 0) {
+    std::fprintf(stderr, "server pid %d\n", options.server_pid);
+  }
+
+  bool header_printed = false;
+  auto on_sample = [&header_printed](const LoadSample& s) {
+    if (!header_printed) {
+      std::fprintf(stderr, "%8s %10s %8s %10s\n", "time", "req/s", "errors",
+                   "rss MiB");
+      header_printed = true;
+    }
+    if (s.rss_kb >= 0) {
+      std::fprintf(stderr, "%7.1fs %10.1f %8llu %10.1f\n", s.t_s,
+                   s.requests_per_s, static_cast<unsigned long long>(s.errors),
+                   s.rss_kb / 1024.0);
+    } else {
+      std::fprintf(stderr, "%7.1fs %10.1f %8llu %10s\n", s.t_s,
+                   s.requests_per_s, static_cast<unsigned long long>(s.errors),
+                   "-");
+    }
+  };
+  LoadReport report;
+  if (!RunLoad(options, on_sample, &report, &error)) {
+    std::fprintf(stderr, "gitgraph_loadtest: %s\n", error.c_str());
+    return 1;
+  }
+  if (json) {
+    std::printf("%s\n", LoadReportJson(options, report).c_str());
+  } else {
+    PrintLoadReport(report, stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include "object_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Writes all of |data| to the pipe |fd| with SIGPIPE blocked on this thread
+// only, so a dead reader surfaces as EPIPE instead of killing the process,
+// without touching the signal disposition of the embedding program.
+bool WriteToPipe(int fd, const char* data, size_t size) {
+  sigset_t block, old;
+  sigemptyset(&block);
+  sigaddset(&block, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &block, &old);
+  bool ok = true;
+  bool broken = false;
+  while (size > 0) {
+    const ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      broken = n < 0 && errno == EPIPE;
+      ok = false;
+      break;
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  if (broken && !sigismember(&old, SIGPIPE)) {
+    // Consume the SIGPIPE raised for this thread before unblocking it, unless
+    // one was already pending before the write.
+    sigset_t pending;
+    sigpending(&pending);
+    if (sigismember(&pending, SIGPIPE)) {
+      const timespec zero = {0, 0};
+      while (sigtimedwait(&block, nullptr, &zero) < 0 && errno == EINTR) {
+      }
+    }
+  }
+  pthread_sigmask(SIG_SETMASK, &old, nullptr);
+  return ok;
+}
+
+}  // namespace
+
+ObjectReader::ObjectReader(const std::string& repo_path) {
+  const std::vector<std::string> args = {"git", "-C", repo_path, "cat-file",
+                                         "--batch"};
+  std::vector<char*> argv;
+  for (const auto& s : args) argv.push_back(const_cast<char*>(s.c_str()));
+  argv.push_back(nullptr);
+
+  int in_pipe[2];
+  int out_pipe[2];
+  if (pipe2(in_pipe, O_CLOEXEC) != 0) {
+    error_ = std::string("pipe: ") + std::strerror(errno);
+    return;
+  }
+  if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+    close(in_pipe[0]);
+    close(in_pipe[1]);
+    error_ = std::string("pipe: ") + std::strerror(errno);
+    return;
+  }
+  const pid_t pid = fork();
+  if (pid < 0) {
+    error_ = std::string("fork: ") + std::strerror(errno);
+    close(in_pipe[0]);
+    close(in_pipe[1]);
+    close(out_pipe[0]);
+    close(out_pipe[1]);
+    return;
+  }
+  if (pid == 0) {
+    dup2(in_pipe[0], STDIN_FILENO);
+    dup2(out_pipe[1], STDOUT_FILENO);
+    close(in_pipe[0]);
+    close(in_pipe[1]);
+    close(out_pipe[0]);
+    close(out_pipe[1]);
+    execvp("git", argv.data());
+    _exit(127);
+  }
+  close(in_pipe[0]);
+  close(out_pipe[1]);
+  to_git_ = in_pipe[1];
+  from_git_ = fdopen(out_pipe[0], "r");
+  pid_ = pid;
+}
+
+ObjectReader::~ObjectReader() {
+  if (to_git_ >= 0) close(to_git_);
+  if (from_git_ != nullptr) fclose(from_git_);
+  if (pid_ > 0) {
+    int status;
+    while (waitpid(pid_, &status, 0) < 0 && errno == EINTR) {
+    }
+  }
+}
+
+bool ObjectReader::Read(const Oid& oid, std::string* type, std::string* data) {
+  if (!ok()) return false;
+  const std::string line = OidToHex(oid) + "\n";
+  if (!WriteToPipe(to_git_, line.data(), line.size())) {
+    error_ = "cat-file: write failed";
+    return false;
+  }
+  // Header: "<oid> <type> <size>\n" or "<oid> missing\n".
+  std::string header;
+  for (;;) {
+    const int ch = fgetc(from_git_);
+    if (ch == EOF) {
+      error_ = "cat-file: unexpected end of output";
+      return false;
+    }
+    if (ch == '\n') break;
+    header.push_back(static_cast<char>(ch));
+  }
+  const size_t sp1 = header.find(' ');
+  const size_t sp2 = header.find(' ', sp1 + 1);
+  if (sp1 == std::string::npos || sp2 == std::string::npos) return false;
+  *type = header.substr(sp1 + 1, sp2 - sp1 - 1);
+  const size_t size = std::strtoull(header.c_str() + sp2 + 1, nullptr, 10);
+  data->resize(size);
+  if (size > 0 && std::fread(&(*data)[0], 1, size, from_git_) != size) {
+    error_ = "cat-file: short read";
+    return false;
+  }
+  fgetc(from_git_);  // Trailing newline.
+  return true;
+}
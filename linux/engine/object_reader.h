@@ -0,0 +1,35 @@
+#ifndef ENGINE_OBJECT_READER_H_
+#define ENGINE_OBJECT_READER_H_
+
+#include <sys/types.h>
+
+#include <cstdio>
+#include <string>
+
+#include "oid.h"
+
+// Reads objects through one long-lived `git cat-file --batch` process, so a
+// walk over thousands of trees costs one fork instead of one per object.
+// Not thread-safe; give each worker its own reader.
+class ObjectReader {
+ public:
+  explicit ObjectReader(const std::string& repo_path);
+  ~ObjectReader();
+
+  ObjectReader(const ObjectReader&) = delete;
+  ObjectReader& operator=(const ObjectReader&) = delete;
+
+  bool ok() const { return pid_ > 0; }
+  const std::string& error() const { return error_; }
+
+  // Fetches |oid|. Returns false if it is missing or the process failed.
+  bool Read(const Oid& oid, std::string* type, std::string* data);
+
+ private:
+  pid_t pid_ = -1;
+  int to_git_ = -1;
+  FILE* from_git_ = nullptr;
+  std::string error_;
+};
+
+#endif  // ENGINE_OBJECT_READER_H_
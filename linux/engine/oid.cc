@@ -0,0 +1,42 @@
+#include "oid.h"
+
+namespace {
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+}  // namespace
+
+bool ParseHex(const char* hex, size_t size, uint8_t* out) {
+  if (size % 2 != 0) return false;
+  for (size_t i = 0; i < size / 2; i++) {
+    const int hi = HexValue(hex[2 * i]);
+    const int lo = HexValue(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i] = static_cast<uint8_t>((hi << 4) | lo);
+  }
+  return true;
+}
+
+std::string HexEncode(const uint8_t* data, size_t size) {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string hex(size * 2, '0');
+  for (size_t i = 0; i < size; i++) {
+    hex[2 * i] = kDigits[data[i] >> 4];
+    hex[2 * i + 1] = kDigits[data[i] & 0xf];
+  }
+  return hex;
+}
+
+bool ParseOid(const std::string& hex, Oid* out) {
+  return hex.size() == kOidSize * 2 &&
+         ParseHex(hex.data(), hex.size(), out->data());
+}
+
+std::string OidToHex(const Oid& oid) {
+  return HexEncode(oid.data(), oid.size());
+}
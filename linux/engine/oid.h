@@ -0,0 +1,32 @@
+#ifndef ENGINE_OID_H_
+#define ENGINE_OID_H_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Raw SHA-1 object id. SHA-256 repositories are rejected where raw ids are
+// needed (commit-graph parsing, tree walking).
+constexpr size_t kOidSize = 20;
+using Oid = std::array<uint8_t, kOidSize>;
+
+// Parses 40 hex digits. Returns false on any other input.
+bool ParseOid(const std::string& hex, Oid* out);
+std::string OidToHex(const Oid& oid);
+
+// Decodes |size| hex digits (an even number) into |out|, for ids of either
+// hash function.
+bool ParseHex(const char* hex, size_t size, uint8_t* out);
+std::string HexEncode(const uint8_t* data, size_t size);
+
+struct OidHash {
+  size_t operator()(const Oid& oid) const {
+    // Object ids are already uniformly distributed.
+    size_t h;
+    std::memcpy(&h, oid.data(), sizeof(h));
+    return h;
+  }
+};
+
+#endif  // ENGINE_OID_H_
@@ -0,0 +1,166 @@
+#include "path_filter.h"
+
+#include <algorithm>
+
+#include "changed_path_index.h"
+#include "json_writer.h"
+#include "object_reader.h"
+#include "repo_state.h"
+#include "tree_diff.h"
+
+namespace {
+
+// Oid and mode of the filtered path in one commit's tree, resolved on
+// demand.
+struct PathVersion {
+  bool resolved = false;
+  bool exists = false;
+  Oid oid{};
+  uint32_t mode = 0;
+};
+
+}  // namespace
+
+std::string NormalizeRepoPath(const std::string& path) {
+  std::string out;
+  for (char c : path) out.push_back(c == '\\' ? '/' : c);
+  while (out.compare(0, 2, "./") == 0) out.erase(0, 2);
+  while (!out.empty() && out.front() == '/') out.erase(0, 1);
+  while (!out.empty() && out.back() == '/') out.pop_back();
+  return out;
+}
+
+std::string PathFilterJson(RepoState* repo, const std::string& raw_path) {
+  const std::string path = NormalizeRepoPath(raw_path);
+  if (path.empty()) return JsonError("path required");
+  std::string error;
+  const ChangedPathIndex* index = AcquireChangedPathIndex(repo, &error);
+  if (index == nullptr) return JsonError(error);
+
+  const CommitLog& log = repo->log;
+  const uint32_t n = log.size();
+  ObjectReader reader(repo->path);
+  if (!reader.ok()) return JsonError(reader.error());
+  PathResolver resolver(&reader, path);
+  std::vector<PathVersion> versions(n);
+  auto version_of = [&](uint32_t row) -> const PathVersion* {
+    PathVersion& v = versions[row];
+    if (v.resolved) return &v;
+    Oid tree;
+    if (!log.GetTree(row, &tree)) {
+      error = "unsupported object id in " + log.id(row);
+      return nullptr;
+    }
+    error.clear();
+    v.exists = resolver.Resolve(tree, &v.oid, &v.mode, &error);
+    if (!error.empty()) return nullptr;
+    v.resolved = true;
+    return &v;
+  };
+  // A parent outside the loaded history counts as not having the path.
+  auto same = [&](uint32_t row, uint32_t parent, bool* result) {
+    const PathVersion* a = version_of(row);
+    if (a == nullptr) return false;
+    if (parent == kNoCommit) {
+      *result = !a->exists;
+      return true;
+    }
+    const PathVersion* b = version_of(parent);
+    if (b == nullptr) return false;
+    // A mode-only change (chmod +x, file to symlink) is a change, as in git.
+    *result = a->exists == b->exists &&
+              (!a->exists || (a->oid == b->oid && a->mode == b->mode));
+    return true;
+  };
+
+  // target[row] is row itself when it changed the path, otherwise the
+  // nearest changing ancestor along the TREESAME parent it follows. Rows are
+  // children-first, so walking backwards sees every parent first.
+  std::vector<uint32_t> target(n, kNoCommit);
+  ChangedPathIndex::Query query(path);
+  size_t bloom_skipped = 0;
+  size_t verified = 0;
+  for (uint32_t row = n; row-- > 0;) {
+    const RowSpan parents = log.parents(row);
+    // A parent outside the loaded history never matches (see same()), so
+    // such a row is verified even when its filter rules the path out.
+    if (parents.size() == 1 && parents[0] != kNoCommit &&
+        index->Check(row, &query) == BloomResult::kDefinitelyNot) {
+      bloom_skipped++;
+      target[row] = target[parents[0]];
+      continue;
+    }
+    verified++;
+    if (parents.empty()) {
+      const PathVersion* v = version_of(row);
+      if (v == nullptr) return JsonError(error);
+      target[row] = v->exists ? row : kNoCommit;
+      continue;
+    }
+    bool changed = true;
+    for (uint32_t p : parents) {
+      bool treesame = false;
+      if (!same(row, p, &treesame)) return JsonError(error);
+      if (treesame) {
+        // Follow the first TREESAME parent, as git's simplification does.
+        target[row] = p == kNoCommit ? kNoCommit : target[p];
+        changed = false;
+        break;
+      }
+    }
+    if (changed) target[row] = row;
+  }
+
+  JsonWriter w;
+  w.BeginObject();
+  w.Key("path").String(path);
+  w.Key("total").Int(n);
+  w.Key("filters").BeginObject();
+  w.Key("commitGraph").Int(static_cast<int64_t>(index->commit_graph_filters()));
+  w.Key("engine").Int(static_cast<int64_t>(index->engine_filters()));
+  w.Key("computed").Int(static_cast<int64_t>(index->computed_filters()));
+  w.Key("skipped").Int(static_cast<int64_t>(bloom_skipped));
+  w.Key("verified").Int(static_cast<int64_t>(verified));
+  w.EndObject();
+  w.Key("commits").BeginArray();
+  std::vector<uint32_t> parents;
+  for (uint32_t row = 0; row < n; row++) {
+    if (target[row] != row) continue;
+    parents.clear();
+    for (uint32_t p : log.parents(row)) {
+      const uint32_t t = p == kNoCommit ? kNoCommit : target[p];
+      if (t == kNoCommit) continue;
+      if (std::find(parents.begin(), parents.end(), t) == parents.end()) {
+        parents.push_back(t);
+      }
+    }
+    w.BeginObject();
+    w.Key("id").String(log.id(row));
+    w.Key("parents").BeginArray();
+    for (uint32_t p : parents) w.String(log.id(p));
+    w.EndArray();
+    w.Key("refs").BeginArray();
+    for (uint32_t r : log.refs(row)) w.String(log.string(r));
+    w.EndArray();
+    w.Key("author").String(log.author(row));
+    w.Key("date").String(log.date(row));
+    w.Key("subject").String(log.subject(row));
+    w.EndObject();
+  }
+  w.EndArray();
+  // Where each decorated commit lands after rewriting, so callers can
+  // rebuild branch chains without another history walk.
+  w.Key("targets").BeginObject();
+  for (uint32_t row = 0; row < n; row++) {
+    if (log.refs(row).empty()) continue;
+    w.Key(log.id(row));
+    if (target[row] == kNoCommit) {
+      w.Null();
+    } else {
+      w.String(log.id(target[row]));
+    }
+  }
+  w.EndObject();
+  w.EndObject();
+  return w.Take();
+}
@@ -0,0 +1,18 @@
+#ifndef ENGINE_PATH_FILTER_H_
+#define ENGINE_PATH_FILTER_H_
+
+#include <string>
+
+struct RepoState;
+
+// History restricted to commits that changed |path|, with parents rewritten
+// to the nearest such ancestor, like `git log --parents -- <path>`.
+// Changed-path Bloom filters rule out most commits before any tree is read;
+// the rest are confirmed by comparing the path's oid against each parent.
+std::string PathFilterJson(RepoState* repo, const std::string& path);
+
+// Turns user input such as ".\reports\annual.docx" into a repo-relative
+// path with forward slashes.
+std::string NormalizeRepoPath(const std::string& path);
+
+#endif  // ENGINE_PATH_FILTER_H_
@@ -0,0 +1,65 @@
+#include "repo_state.h"
+
+#include <map>
+
+namespace {
+
+struct Slot {
+  std::mutex load_mutex;
+  std::shared_ptr<RepoState> state;
+};
+
+std::mutex g_registry_mutex;
+std::map<std::string, std::shared_ptr<Slot>> g_registry;
+
+}  // namespace
+
+std::shared_ptr<RepoState> AcquireRepo(const std::string& repo_path,
+                                       std::string* error) {
+  std::shared_ptr<Slot> slot;
+  {
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    auto& entry = g_registry[repo_path];
+    if (!entry) entry = std::make_shared<Slot>();
+    slot = entry;
+  }
+  std::lock_guard<std::mutex> lock(slot->load_mutex);
+  if (slot->state) return slot->state;
+
+  auto state = std::make_shared<RepoState>();
+  state->path = repo_path;
+  if (!LoadCommitLog(repo_path, &state->log, error)) return nullptr;
+  slot->state = state;
+  return state;
+}
+
+const HistoryLayout& AcquireLayout(RepoState* repo) {
+  std::lock_guard<std::mutex> lock(repo->layout_mutex);
+  if (!repo->layout) repo->layout.reset(new HistoryLayout(repo->log));
+  return *repo->layout;
+}
+
+const SearchIndex& AcquireSearchIndex(RepoState* repo) {
+  std::lock_guard<std::mutex> lock(repo->search_mutex);
+  if (!repo->search) repo->search.reset(new SearchIndex(repo->log));
+  return *repo->search;
+}
+
+const ChangedPathIndex* AcquireChangedPathIndex(RepoState* repo,
+                                                std::string* error) {
+  std::lock_guard<std::mutex> lock(repo->changed_paths_mutex);
+  if (!repo->changed_paths) {
+    repo->changed_paths = ChangedPathIndex::Open(repo->path, repo->log, error);
+  }
+  return repo->changed_paths.get();
+}
+
+void ResetRepos() {
+  std::lock_guard<std::mutex> lock(g_registry_mutex);
+  g_registry.clear();
+}
+
+void ForgetRepo(const std::string& repo_path) {
+  std::lock_guard<std::mutex> lock(g_registry_mutex);
+  g_registry.erase(repo_path);
+}
@@ -0,0 +1,56 @@
+#ifndef ENGINE_REPO_STATE_H_
+#define ENGINE_REPO_STATE_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "change_stats.h"
+#include "changed_path_index.h"
+#include "commit_log.h"
+#include "history_window.h"
+#include "search_index.h"
+
+// Everything the engine has derived for one repository. The native side
+// caches these per repo path, the same way git_service.dart caches
+// GraphResponses, until gg_reset() is called.
+struct RepoState {
+  std::string path;
+  CommitLog log;
+
+  // Built on first use, so opening the commit store for /graph costs only
+  // the history load.
+  std::mutex layout_mutex;
+  std::unique_ptr<HistoryLayout> layout;
+  std::mutex search_mutex;
+  std::unique_ptr<SearchIndex> search;
+
+  // Built on the first path-filtered query.
+  std::mutex changed_paths_mutex;
+  std::unique_ptr<ChangedPathIndex> changed_paths;
+
+  // Per-commit diff stats, filled in as the UI asks for them.
+  ChangeStatsCache stats_cache;
+};
+
+// Returns the cached state for |repo_path|, loading the history on first
+// use. Concurrent callers for the same repo wait for a single load.
+std::shared_ptr<RepoState> AcquireRepo(const std::string& repo_path,
+                                       std::string* error);
+
+// Return |repo|'s lane layout and search index, building them on first use.
+// They live as long as |repo|.
+const HistoryLayout& AcquireLayout(RepoState* repo);
+const SearchIndex& AcquireSearchIndex(RepoState* repo);
+
+// Returns |repo|'s changed-path Bloom index, building (and persisting) it on
+// first use. The index lives as long as |repo|.
+const ChangedPathIndex* AcquireChangedPathIndex(RepoState* repo,
+                                                std::string* error);
+
+// Drops every cached repository. States still held by callers stay valid.
+void ResetRepos();
+// Drops the cached state of |repo_path| only, so its next use reloads it.
+void ForgetRepo(const std::string& repo_path);
+
+#endif  // ENGINE_REPO_STATE_H_
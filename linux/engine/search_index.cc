@@ -0,0 +1,275 @@
+#include "search_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+#include "json_writer.h"
+
+namespace {
+
+void FoldInPlace(std::string* s) {
+  for (char& c : *s) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+  }
+}
+
+std::string Fold(std::string_view s) {
+  std::string out(s);
+  FoldInPlace(&out);
+  return out;
+}
+
+void AddTrigrams(const std::string& folded, std::vector<uint32_t>* out) {
+  const auto* b = reinterpret_cast<const uint8_t*>(folded.data());
+  for (size_t i = 0; i + 3 <= folded.size(); i++) {
+    out->push_back(static_cast<uint32_t>(b[i]) << 16 |
+                   static_cast<uint32_t>(b[i + 1]) << 8 | b[i + 2]);
+  }
+}
+
+void PutVarint(std::vector<uint8_t>* out, uint32_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t GetVarint(const uint8_t** p) {
+  uint32_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    const uint8_t b = *(*p)++;
+    value |= static_cast<uint32_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) return value;
+  }
+}
+
+std::vector<std::string> SplitTerms(const std::string& query) {
+  std::vector<std::string> terms;
+  std::string current;
+  for (char c : query) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      if (!current.empty()) terms.push_back(Fold(current));
+      current.clear();
+    } else {
+      current.push_back(c);
+    }
+  }
+  if (!current.empty()) terms.push_back(Fold(current));
+  return terms;
+}
+
+bool ContainsFolded(std::string_view field, const std::string& term) {
+  thread_local std::string folded;
+  folded.assign(field);
+  FoldInPlace(&folded);
+  return folded.find(term) != std::string::npos;
+}
+
+}  // namespace
+
+SearchIndex::SearchIndex(const CommitLog& log) : log_(log) {
+  struct Builder {
+    std::vector<uint8_t> bytes;
+    uint32_t last = 0;
+    uint32_t count = 0;
+  };
+  std::unordered_map<uint32_t, Builder> lists;
+  std::vector<uint32_t> grams;
+  const uint32_t n = log.size();
+  // Rows are visited in order, so every list is built already sorted and
+  // can be delta-encoded on the fly.
+  for (uint32_t row = 0; row < n; row++) {
+    grams.clear();
+    AddTrigrams(Fold(log.subject(row)), &grams);
+    AddTrigrams(Fold(log.author(row)), &grams);
+    for (uint32_t ref : log.refs(row)) {
+      AddTrigrams(Fold(log.string(ref)), &grams);
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    for (uint32_t g : grams) {
+      Builder& b = lists[g];
+      PutVarint(&b.bytes, row - b.last);
+      b.last = row;
+      b.count++;
+    }
+  }
+
+  directory_.reserve(lists.size());
+  size_t total_bytes = 0;
+  for (const auto& e : lists) {
+    directory_.push_back({e.first, e.second.count, 0});
+    total_bytes += e.second.bytes.size();
+  }
+  std::sort(directory_.begin(), directory_.end(),
+            [](const PostingList& a, const PostingList& b) {
+              return a.trigram < b.trigram;
+            });
+  postings_.reserve(total_bytes);
+  for (auto& entry : directory_) {
+    entry.offset = postings_.size();
+    const auto& bytes = lists[entry.trigram].bytes;
+    postings_.insert(postings_.end(), bytes.begin(), bytes.end());
+  }
+}
+
+const SearchIndex::PostingList* SearchIndex::Find(uint32_t trigram) const {
+  auto it = std::lower_bound(directory_.begin(), directory_.end(), trigram,
+                             [](const PostingList& e, uint32_t t) {
+                               return e.trigram < t;
+                             });
+  if (it == directory_.end() || it->trigram != trigram) return nullptr;
+  return &*it;
+}
+
+std::vector<uint32_t> SearchIndex::Candidates(const std::string& term) const {
+  std::vector<uint32_t> grams;
+  AddTrigrams(term, &grams);
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+  std::vector<const PostingList*> lists;
+  for (uint32_t g : grams) {
+    const PostingList* list = Find(g);
+    if (list == nullptr) return {};
+    lists.push_back(list);
+  }
+  // Intersect the shortest lists first so the running set shrinks fast.
+  std::sort(lists.begin(), lists.end(),
+            [](const PostingList* a, const PostingList* b) {
+              return a->count < b->count;
+            });
+
+  std::vector<uint32_t> rows;
+  const uint8_t* p = postings_.data() + lists[0]->offset;
+  rows.reserve(lists[0]->count);
+  uint32_t row = 0;
+  for (uint32_t i = 0; i < lists[0]->count; i++) {
+    row += GetVarint(&p);
+    rows.push_back(row);
+  }
+  for (size_t l = 1; l < lists.size() && !rows.empty(); l++) {
+    const uint8_t* q = postings_.data() + lists[l]->offset;
+    uint32_t remaining = lists[l]->count;
+    uint32_t other = 0;
+    bool have = false;
+    size_t out = 0;
+    for (uint32_t r : rows) {
+      while ((!have || other < r) && remaining > 0) {
+        other += GetVarint(&q);
+        remaining--;
+        have = true;
+      }
+      if (!have || other < r) break;
+      if (other == r) rows[out++] = r;
+    }
+    rows.resize(out);
+  }
+  return rows;
+}
+
+uint8_t SearchIndex::MatchFields(uint32_t row, const std::string& term) const {
+  uint8_t fields = 0;
+  if (ContainsFolded(log_.subject(row), term)) fields |= kSubject;
+  if (ContainsFolded(log_.author(row), term)) fields |= kAuthor;
+  for (uint32_t ref : log_.refs(row)) {
+    if (ContainsFolded(log_.string(ref), term)) {
+      fields |= kRefs;
+      break;
+    }
+  }
+  return fields;
+}
+
+bool SearchIndex::IsSearchable(const std::string& query) {
+  for (const auto& term : SplitTerms(query)) {
+    if (term.size() >= kMinTermSize) return true;
+  }
+  return false;
+}
+
+std::vector<SearchIndex::Match> SearchIndex::Search(const std::string& query,
+                                                    size_t limit,
+                                                    size_t* total,
+                                                    size_t* candidates) const {
+  *total = 0;
+  *candidates = 0;
+  const std::vector<std::string> terms = SplitTerms(query);
+
+  // Terms shorter than a trigram cannot use the index; they only filter.
+  std::vector<uint32_t> rows;
+  bool indexed = false;
+  for (const auto& term : terms) {
+    if (term.size() < kMinTermSize) continue;
+    std::vector<uint32_t> c = Candidates(term);
+    if (indexed) {
+      std::vector<uint32_t> both;
+      std::set_intersection(rows.begin(), rows.end(), c.begin(), c.end(),
+                            std::back_inserter(both));
+      rows.swap(both);
+    } else {
+      rows.swap(c);
+      indexed = true;
+    }
+    if (rows.empty()) return {};
+  }
+  if (!indexed) return {};
+  *candidates = rows.size();
+
+  std::vector<Match> matches;
+  for (uint32_t row : rows) {
+    uint8_t fields = 0;
+    bool all = true;
+    for (const auto& term : terms) {
+      const uint8_t f = MatchFields(row, term);
+      if (f == 0) {
+        all = false;
+        break;
+      }
+      fields |= f;
+    }
+    if (!all) continue;
+    if (matches.size() < limit) matches.push_back({row, fields});
+    (*total)++;
+  }
+  return matches;
+}
+
+std::string SearchJson(const CommitLog& log,
+                       const HistoryLayout& layout,
+                       const SearchIndex& index,
+                       const std::string& query,
+                       uint32_t limit) {
+  size_t total = 0;
+  size_t candidates = 0;
+  const auto matches = index.Search(query, limit, &total, &candidates);
+  JsonWriter w;
+  w.BeginObject();
+  w.Key("query").String(query);
+  // Lets the viewer ask for more input instead of reporting no matches.
+  w.Key("searchable").Bool(SearchIndex::IsSearchable(query));
+  w.Key("total").Int(static_cast<int64_t>(total));
+  w.Key("candidates").Int(static_cast<int64_t>(candidates));
+  w.Key("matches").BeginArray();
+  for (const auto& m : matches) {
+    w.BeginObject();
+    w.Key("row").Int(m.row);
+    w.Key("lane").Int(layout.lane_of(m.row));
+    w.Key("id").String(log.id(m.row));
+    w.Key("fields").BeginArray();
+    if (m.fields & SearchIndex::kSubject) w.String("subject");
+    if (m.fields & SearchIndex::kAuthor) w.String("author");
+    if (m.fields & SearchIndex::kRefs) w.String("refs");
+    w.EndArray();
+    w.EndObject();
+  }
+  w.EndArray();
+  w.Key("index").BeginObject();
+  w.Key("rows").Int(log.size());
+  w.Key("trigrams").Int(static_cast<int64_t>(index.trigram_count()));
+  w.Key("postingBytes").Int(static_cast<int64_t>(index.posting_bytes()));
+  w.EndObject();
+  w.EndObject();
+  return w.Take();
+}
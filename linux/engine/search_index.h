@@ -0,0 +1,76 @@
+#ifndef ENGINE_SEARCH_INDEX_H_
+#define ENGINE_SEARCH_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "commit_log.h"
+#include "history_window.h"
+
+// Trigram inverted index over the subject, author and refs of every row.
+// Text is folded to ASCII lower case and split into byte trigrams, so
+// multi-byte UTF-8 (e.g. Chinese subjects) is matched as plain bytes.
+// Posting lists hold ascending rows, delta-encoded as LEB128 varints.
+class SearchIndex {
+ public:
+  enum Field : uint8_t {
+    kSubject = 1 << 0,
+    kAuthor = 1 << 1,
+    kRefs = 1 << 2,
+  };
+
+  struct Match {
+    uint32_t row;
+    uint8_t fields;  // Fields that contain at least one query term.
+  };
+
+  // Bytes in the shortest term the index can look up.
+  static constexpr size_t kMinTermSize = 3;
+
+  explicit SearchIndex(const CommitLog& log);
+
+  // True when |query| has a term of at least kMinTermSize bytes. Shorter
+  // terms only narrow the rows such a term selects; on their own they
+  // would mean verifying every row, so Search() matches nothing.
+  static bool IsSearchable(const std::string& query);
+
+  // Rows containing every whitespace-separated term of |query| as a
+  // case-insensitive substring of some field, in row order. At most |limit|
+  // matches are returned; |*total| receives the full count and
+  // |*candidates| the rows that had to be verified.
+  std::vector<Match> Search(const std::string& query,
+                            size_t limit,
+                            size_t* total,
+                            size_t* candidates) const;
+
+  size_t trigram_count() const { return directory_.size(); }
+  size_t posting_bytes() const { return postings_.size(); }
+
+ private:
+  struct PostingList {
+    uint32_t trigram;
+    uint32_t count;
+    uint64_t offset;  // Into postings_.
+  };
+
+  const PostingList* Find(uint32_t trigram) const;
+  // Rows that contain every trigram of |term|, ascending.
+  std::vector<uint32_t> Candidates(const std::string& term) const;
+  uint8_t MatchFields(uint32_t row, const std::string& term) const;
+
+  const CommitLog& log_;
+  std::vector<PostingList> directory_;  // Sorted by trigram.
+  std::vector<uint8_t> postings_;
+};
+
+// Serializes a search for the /search endpoint, with each match's lane so
+// the viewer can jump straight to it.
+std::string SearchJson(const CommitLog& log,
+                       const HistoryLayout& layout,
+                       const SearchIndex& index,
+                       const std::string& query,
+                       uint32_t limit);
+
+#endif  // ENGINE_SEARCH_INDEX_H_
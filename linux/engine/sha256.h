@@ -0,0 +1,39 @@
+#ifndef ENGINE_SHA256_H_
+#define ENGINE_SHA256_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using Sha256Digest = std::array<uint8_t, 32>;
+
+// Plain FIPS 180-4 SHA-256, so the backup store does not pull in a crypto
+// library for content addressing.
+class Sha256 {
+ public:
+  Sha256();
+
+  void Update(const void* data, size_t size);
+  Sha256Digest Finish();
+
+  static Sha256Digest Of(const void* data, size_t size);
+
+ private:
+  void Compress(const uint8_t* block);
+
+  uint32_t state_[8];
+  uint8_t block_[64];
+  size_t block_size_ = 0;
+  uint64_t total_ = 0;
+};
+
+struct Sha256DigestHash {
+  size_t operator()(const Sha256Digest& digest) const {
+    size_t h;
+    std::memcpy(&h, digest.data(), sizeof(h));
+    return h;
+  }
+};
+
+#endif  // ENGINE_SHA256_H_
@@ -0,0 +1,229 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "oid.h"
+
+namespace {
+
+constexpr char kHeader[] = "gitgraph-snapshot 1";
+
+void AppendEscaped(const std::string& s, std::string* out) {
+  static const char kHex[] = "0123456789abcdef";
+  for (unsigned char c : s) {
+    if (c <= ' ' || c == '%' || c == 0x7f) {
+      out->push_back('%');
+      out->push_back(kHex[c >> 4]);
+      out->push_back(kHex[c & 15]);
+    } else {
+      out->push_back(static_cast<char>(c));
+    }
+  }
+}
+
+bool Unescape(const std::string& s, std::string* out) {
+  out->clear();
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] != '%') {
+      out->push_back(s[i]);
+      continue;
+    }
+    uint8_t byte;
+    if (i + 2 >= s.size() || !ParseHex(s.data() + i + 1, 2, &byte)) {
+      return false;
+    }
+    out->push_back(static_cast<char>(byte));
+    i += 2;
+  }
+  return true;
+}
+
+// Restore joins entry paths onto the destination, so a manifest must not
+// be able to point outside it.
+bool IsRelativePath(const std::string& path) {
+  if (path.empty() || path[0] == '/') return false;
+  size_t start = 0;
+  for (;;) {
+    const size_t slash = path.find('/', start);
+    const std::string part = path.substr(start, slash - start);
+    if (part.empty() || part == "." || part == "..") return false;
+    if (slash == std::string::npos) return true;
+    start = slash + 1;
+  }
+}
+
+// Splits |line| at spaces into exactly |count| fields.
+bool SplitFields(const std::string& line,
+                 size_t count,
+                 std::vector<std::string>* fields) {
+  fields->clear();
+  size_t start = 0;
+  for (;;) {
+    const size_t space = line.find(' ', start);
+    fields->push_back(line.substr(start, space - start));
+    if (space == std::string::npos) break;
+    start = space + 1;
+  }
+  return fields->size() == count;
+}
+
+bool ParseInt(const std::string& s, int64_t* out) {
+  if (s.empty()) return false;
+  char* end = nullptr;
+  errno = 0;
+  *out = std::strtoll(s.c_str(), &end, 10);
+  return *end == 0 && errno == 0;
+}
+
+bool ParseUint(const std::string& s, int base, uint64_t* out) {
+  if (s.empty() || s[0] == '-') return false;
+  char* end = nullptr;
+  errno = 0;
+  *out = std::strtoull(s.c_str(), &end, base);
+  return *end == 0 && errno == 0;
+}
+
+}  // namespace
+
+bool WriteSnapshot(const std::string& path,
+                   const Snapshot& snapshot,
+                   std::string* error) {
+  std::string text = kHeader;
+  text += "\nsource ";
+  AppendEscaped(snapshot.source, &text);
+  text += "\ntime " + std::to_string(snapshot.time) + "\n";
+  char buf[160];
+  for (const SnapshotEntry& e : snapshot.entries) {
+    switch (e.type) {
+      case SnapshotEntry::kDirectory:
+        std::snprintf(buf, sizeof(buf), "d %o %" PRId64 " ", e.mode,
+                      e.mtime_ns);
+        break;
+      case SnapshotEntry::kFile:
+        std::snprintf(buf, sizeof(buf),
+                      "f %o %" PRId64 " %" PRIu64 " %" PRId64 " %" PRIu64 " ",
+                      e.mode, e.mtime_ns, e.size, e.ctime_ns, e.inode);
+        break;
+      case SnapshotEntry::kSymlink:
+        std::snprintf(buf, sizeof(buf), "l %" PRId64 " ", e.mtime_ns);
+        break;
+    }
+    text += buf;
+    if (e.type == SnapshotEntry::kSymlink) {
+      AppendEscaped(e.target, &text);
+      text.push_back(' ');
+    }
+    AppendEscaped(e.path, &text);
+    text.push_back('\n');
+    for (const ChunkRef& c : e.chunks) {
+      text += "c " + HexEncode(c.digest.data(), c.digest.size()) + " " +
+              std::to_string(c.size) + "\n";
+    }
+  }
+
+  const std::string tmp = path + ".tmp";
+  FILE* f = std::fopen(tmp.c_str(), "wb");
+  if (f == nullptr) {
+    *error = "cannot write " + tmp + ": " + std::strerror(errno);
+    return false;
+  }
+  bool ok = std::fwrite(text.data(), 1, text.size(), f) == text.size() &&
+            std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+  ok = std::fclose(f) == 0 && ok;
+  if (ok) ok = std::rename(tmp.c_str(), path.c_str()) == 0;
+  if (!ok) {
+    *error = "cannot write " + path + ": " + std::strerror(errno);
+    std::remove(tmp.c_str());
+    return false;
+  }
+  // The rename itself is durable only once the directory is synced.
+  const std::string dir = path.substr(0, path.rfind('/') + 1);
+  const int fd =
+      open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  ok = fd >= 0 && fsync(fd) == 0;
+  if (!ok) *error = "cannot sync " + dir + ": " + std::strerror(errno);
+  if (fd >= 0) close(fd);
+  return ok;
+}
+
+bool ReadSnapshot(const std::string& path,
+                  Snapshot* snapshot,
+                  std::string* error) {
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (f == nullptr) {
+    *error = "cannot read " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  std::string text;
+  char buf[64 * 1024];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+  std::fclose(f);
+
+  *snapshot = Snapshot();
+  std::vector<std::string> fields;
+  size_t line_no = 0;
+  size_t pos = 0;
+  bool ok = true;
+  while (ok && pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    if (end == std::string::npos) end = text.size();
+    const std::string line = text.substr(pos, end - pos);
+    pos = end + 1;
+    line_no++;
+
+    if (line_no == 1) {
+      ok = line == kHeader;
+      continue;
+    }
+    const char kind = line.empty() ? 0 : line[0];
+    uint64_t uvalue = 0;
+    if (line.compare(0, 7, "source ") == 0) {
+      ok = Unescape(line.substr(7), &snapshot->source);
+    } else if (line.compare(0, 5, "time ") == 0) {
+      ok = ParseInt(line.substr(5), &snapshot->time);
+    } else if (kind == 'c') {
+      ChunkRef c;
+      ok = !snapshot->entries.empty() &&
+           snapshot->entries.back().type == SnapshotEntry::kFile &&
+           SplitFields(line, 3, &fields) &&
+           fields[1].size() == 2 * c.digest.size() &&
+           ParseHex(fields[1].data(), fields[1].size(), c.digest.data()) &&
+           ParseUint(fields[2], 10, &uvalue) && uvalue <= UINT32_MAX;
+      c.size = static_cast<uint32_t>(uvalue);
+      if (ok) snapshot->entries.back().chunks.push_back(c);
+    } else if (kind == 'd' || kind == 'f' || kind == 'l') {
+      SnapshotEntry e;
+      e.type = static_cast<SnapshotEntry::Type>(kind);
+      const size_t count = kind == 'd' ? 4 : kind == 'f' ? 7 : 4;
+      ok = SplitFields(line, count, &fields) &&
+           Unescape(fields.back(), &e.path) && IsRelativePath(e.path);
+      if (ok && kind != 'l') {
+        ok = ParseUint(fields[1], 8, &uvalue) && uvalue <= 07777;
+        e.mode = static_cast<uint32_t>(uvalue);
+      }
+      ok = ok && ParseInt(fields[kind == 'l' ? 1 : 2], &e.mtime_ns);
+      if (ok && kind == 'f') {
+        ok = ParseUint(fields[3], 10, &e.size) &&
+             ParseInt(fields[4], &e.ctime_ns) &&
+             ParseUint(fields[5], 10, &e.inode);
+      }
+      if (ok && kind == 'l') ok = Unescape(fields[2], &e.target);
+      if (ok) snapshot->entries.push_back(std::move(e));
+    } else {
+      ok = false;
+    }
+  }
+  if (!ok || line_no == 0) {
+    *error = path + ":" + std::to_string(line_no) + ": malformed snapshot";
+    return false;
+  }
+  return true;
+}
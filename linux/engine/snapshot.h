@@ -0,0 +1,66 @@
+#ifndef ENGINE_SNAPSHOT_H_
+#define ENGINE_SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sha256.h"
+
+struct ChunkRef {
+  Sha256Digest digest;
+  uint32_t size;
+};
+
+// One directory, regular file or symlink under the backed-up root. |path|
+// is relative to the root with '/' separators; parents precede children.
+struct SnapshotEntry {
+  enum Type : char {
+    kDirectory = 'd',
+    kFile = 'f',
+    kSymlink = 'l',
+  };
+
+  Type type = kFile;
+  std::string path;
+  uint32_t mode = 0;  // Permission bits only.
+  int64_t mtime_ns = 0;
+  // Files: contents, and the stat fields used to tell whether the next
+  // backup can reuse |chunks| without reading the file.
+  uint64_t size = 0;
+  int64_t ctime_ns = 0;
+  uint64_t inode = 0;
+  std::vector<ChunkRef> chunks;
+  // Symlinks.
+  std::string target;
+};
+
+// Manifest of one backup. Stored as text, one entry per line followed by
+// its chunk lines:
+//
+//   gitgraph-snapshot 1
+//   source /abs/path/of/repo
+//   time <unix seconds>
+//   d <mode> <mtime_ns> <path>
+//   f <mode> <mtime_ns> <size> <ctime_ns> <inode> <path>
+//   c <sha256> <size>
+//   l <mtime_ns> <target> <path>
+//
+// Paths and link targets are percent-escaped so they hold no whitespace.
+struct Snapshot {
+  std::string source;
+  int64_t time = 0;
+  std::vector<SnapshotEntry> entries;
+};
+
+// Writes through a temporary file and a rename, so a snapshot that exists
+// is always complete. The file and then its directory are fsynced, so the
+// snapshot survives a crash once this returns.
+bool WriteSnapshot(const std::string& path,
+                   const Snapshot& snapshot,
+                   std::string* error);
+bool ReadSnapshot(const std::string& path,
+                  Snapshot* snapshot,
+                  std::string* error);
+
+#endif  // ENGINE_SNAPSHOT_H_
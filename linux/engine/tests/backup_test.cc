@@ -0,0 +1,276 @@
+#include "backup.h"
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "chunk_store.h"
+#include "chunker.h"
+#include "oid.h"
+#include "sha256.h"
+#include "test_repo.h"
+#include "thread_pool.h"
+
+namespace {
+
+std::string Hex(const Sha256Digest& digest) {
+  return HexEncode(digest.data(), digest.size());
+}
+
+std::string RandomBytes(size_t size, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::string out(size, 0);
+  for (char& c : out) c = static_cast<char>(rng());
+  return out;
+}
+
+// Digests of the chunks FindChunkEnd cuts |data| into.
+std::vector<std::string> ChunkDigests(const std::string& data) {
+  std::vector<std::string> digests;
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+  for (size_t at = 0; at < data.size();) {
+    const size_t size = FindChunkEnd(p + at, data.size() - at);
+    digests.push_back(Hex(Sha256::Of(p + at, size)));
+    at += size;
+  }
+  return digests;
+}
+
+// One line per entry below |root|: path, type, mode, size and link target.
+std::string TreeListing(const std::string& root) {
+  return Shell("cd '" + root +
+               "' && find . -mindepth 1 -printf '%p %y %m %s %l\\n' | "
+               "LC_ALL=C sort");
+}
+
+std::vector<std::string> SnapshotIds(const std::string& store) {
+  std::vector<SnapshotSummary> snapshots;
+  std::string error;
+  EXPECT_TRUE(ListSnapshots(store, &snapshots, &error)) << error;
+  std::vector<std::string> ids;
+  for (const SnapshotSummary& s : snapshots) ids.push_back(s.id);
+  return ids;
+}
+
+TEST(BackupTest, Sha256KnownAnswers) {
+  // FIPS 180-4 examples and the one-million-'a' vector.
+  EXPECT_EQ(Hex(Sha256::Of("", 0)),
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  EXPECT_EQ(Hex(Sha256::Of("abc", 3)),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  const std::string two_blocks =
+      "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  EXPECT_EQ(Hex(Sha256::Of(two_blocks.data(), two_blocks.size())),
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  // Fed in uneven pieces, so block carry-over is exercised too.
+  Sha256 hash;
+  const std::string piece(997, 'a');
+  size_t left = 1000000;
+  while (left > 0) {
+    const size_t n = left < piece.size() ? left : piece.size();
+    hash.Update(piece.data(), n);
+    left -= n;
+  }
+  EXPECT_EQ(Hex(hash.Finish()),
+            "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(BackupTest, ChunkBoundariesSurviveAnInsertion) {
+  const std::string before = RandomBytes(4 * 1024 * 1024, 7);
+  std::string after = before;
+  after.insert(before.size() / 2, RandomBytes(100, 8));
+
+  const std::vector<std::string> a = ChunkDigests(before);
+  const std::vector<std::string> b = ChunkDigests(after);
+  ASSERT_GT(a.size(), 8u);
+  const std::unordered_set<std::string> old_chunks(a.begin(), a.end());
+  size_t kept = 0;
+  for (const std::string& d : b) kept += old_chunks.count(d);
+  // Only the chunks around the insertion change.
+  EXPECT_GE(kept + 2, a.size());
+  EXPECT_LE(b.size(), a.size() + 1);
+}
+
+TEST(BackupTest, RestoreMatchesSource) {
+  TempDir src;
+  TempDir work;
+  const std::string store = work.path() + "/store";
+  WriteFile(src.path() + "/README", "hello\n");
+  WriteFile(src.path() + "/empty", "");
+  WriteFile(src.path() + "/deep/dir/big.bin", RandomBytes(1200 * 1024, 3));
+  WriteFile(src.path() + "/name with space", "x");
+  Shell("cd '" + src.path() + "' && chmod 755 README && chmod 700 deep && "
+        "ln -s deep/dir/big.bin link");
+
+  ThreadPool pool(2);
+  BackupOptions options;
+  options.store = store;
+  options.source = src.path();
+  options.name = "repo";
+  std::string id;
+  BackupStats stats;
+  std::string error;
+  ASSERT_TRUE(RunBackup(options, &pool, &id, &stats, &error)) << error;
+  EXPECT_EQ(stats.files, 4u);
+  EXPECT_GT(stats.chunks, 4u);
+
+  const std::string dest = work.path() + "/restore";
+  ASSERT_TRUE(RestoreSnapshot(store, id, dest, &pool, &error)) << error;
+  EXPECT_EQ(TreeListing(dest), TreeListing(src.path()));
+  Shell("diff -r --no-dereference '" + src.path() + "' '" + dest + "'");
+
+  // Unchanged files are reused from the first snapshot, not read again.
+  std::string second;
+  ASSERT_TRUE(RunBackup(options, &pool, &second, &stats, &error)) << error;
+  EXPECT_NE(second, id);
+  EXPECT_EQ(stats.reused_files, 4u);
+  EXPECT_EQ(stats.new_chunks, 0u);
+}
+
+TEST(BackupTest, SameSecondSnapshotsSortNumerically) {
+  TempDir src;
+  TempDir work;
+  const std::string store = work.path() + "/store";
+  WriteFile(src.path() + "/f", "x\n");
+  ThreadPool pool(1);
+  BackupOptions options;
+  options.store = store;
+  options.source = src.path();
+  options.name = "repo";
+  std::string id;
+  BackupStats stats;
+  std::string error;
+  ASSERT_TRUE(RunBackup(options, &pool, &id, &stats, &error)) << error;
+
+  // As if ten backups had landed in the same second.
+  const std::string manifest = store + "/snapshots/" + id;
+  std::vector<std::string> want = {id};
+  for (int n = 2; n <= 10; n++) {
+    Shell("cp '" + manifest + "' '" + manifest + "-" + std::to_string(n) +
+          "'");
+    want.push_back(id + "-" + std::to_string(n));
+  }
+  EXPECT_EQ(SnapshotIds(store), want);
+
+  PruneStats pruned;
+  ASSERT_TRUE(PruneStore(store, 2, &pruned, &error)) << error;
+  EXPECT_EQ(pruned.snapshots_removed, 8u);
+  EXPECT_EQ(SnapshotIds(store),
+            std::vector<std::string>({id + "-9", id + "-10"}));
+}
+
+TEST(BackupTest, PruneWaitsForARunningBackup) {
+  TempDir src;
+  TempDir work;
+  const std::string store = work.path() + "/store";
+  WriteFile(src.path() + "/f", "x\n");
+  ThreadPool pool(1);
+  BackupOptions options;
+  options.store = store;
+  options.source = src.path();
+  std::string id;
+  BackupStats stats;
+  std::string error;
+  ASSERT_TRUE(RunBackup(options, &pool, &id, &stats, &error)) << error;
+
+  // A backup in flight: the shared lock, a chunk no manifest names yet and
+  // a half-written one.
+  auto running = std::make_unique<ChunkStore>();
+  ASSERT_TRUE(
+      running->Open(store, false, ChunkStore::Access::kShared, &error))
+      << error;
+  const std::string data = "not in any manifest yet";
+  const Sha256Digest digest = Sha256::Of(data.data(), data.size());
+  std::vector<uint8_t> scratch;
+  size_t written = 0;
+  ASSERT_TRUE(running->Put(digest,
+                           reinterpret_cast<const uint8_t*>(data.data()),
+                           data.size(), 1, &scratch, &written, &error))
+      << error;
+  WriteFile(store + "/chunks/00/.tmp-running", "partial");
+
+  std::future<bool> prune = std::async(std::launch::async, [&store] {
+    PruneStats pruned;
+    std::string prune_error;
+    return PruneStore(store, 1, &pruned, &prune_error);
+  });
+  EXPECT_EQ(prune.wait_for(std::chrono::milliseconds(300)),
+            std::future_status::timeout);
+  std::vector<uint8_t> out;
+  EXPECT_TRUE(running->Get(digest, data.size(), &out, &error)) << error;
+  EXPECT_NE(Shell("ls -a '" + store + "/chunks/00'").find(".tmp-running"),
+            std::string::npos);
+
+  // Once the backup is done (here: abandoned), prune sweeps both.
+  running.reset();
+  ASSERT_TRUE(prune.get());
+  ChunkStore after;
+  ASSERT_TRUE(after.Open(store, false, ChunkStore::Access::kShared, &error))
+      << error;
+  EXPECT_FALSE(after.Contains(digest));
+  EXPECT_EQ(Shell("ls -a '" + store + "/chunks/00'").find(".tmp-running"),
+            std::string::npos);
+}
+
+TEST(BackupTest, ConcurrentBackupsAndPruneKeepEverySnapshotRestorable) {
+  TempDir src;
+  TempDir work;
+  const std::string store = work.path() + "/store";
+  WriteFile(src.path() + "/a.bin", RandomBytes(600 * 1024, 11));
+  WriteFile(src.path() + "/dir/b.txt", "b\n");
+
+  // Same name, so backups landing in one second race for the id, and a
+  // fresh store, so they also race to create it.
+  constexpr int kBackups = 4;
+  std::vector<std::string> ids(kBackups);
+  std::vector<std::string> errors(kBackups + 2);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kBackups; i++) {
+    threads.emplace_back([&, i] {
+      ThreadPool pool(1);
+      BackupOptions options;
+      options.store = store;
+      options.source = src.path();
+      options.name = "repo";
+      options.rescan = true;
+      BackupStats stats;
+      RunBackup(options, &pool, &ids[i], &stats, &errors[i]);
+    });
+  }
+  for (int i = 0; i < 2; i++) {
+    threads.emplace_back([&, i] {
+      // Prune needs a store; it lands mid-run once the backups made one.
+      std::vector<SnapshotSummary> snapshots;
+      std::string not_yet;
+      while (!ListSnapshots(store, &snapshots, &not_yet)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      PruneStats pruned;
+      PruneStore(store, 0, &pruned, &errors[kBackups + i]);
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  for (const std::string& e : errors) EXPECT_EQ(e, "");
+
+  const std::unordered_set<std::string> distinct(ids.begin(), ids.end());
+  EXPECT_EQ(distinct.size(), static_cast<size_t>(kBackups));
+  EXPECT_EQ(SnapshotIds(store).size(), static_cast<size_t>(kBackups));
+  ThreadPool pool(1);
+  for (int i = 0; i < kBackups; i++) {
+    const std::string dest = work.path() + "/restore" + std::to_string(i);
+    std::string error;
+    ASSERT_TRUE(RestoreSnapshot(store, ids[i], dest, &pool, &error)) << error;
+    EXPECT_EQ(TreeListing(dest), TreeListing(src.path()));
+    Shell("diff -r '" + src.path() + "' '" + dest + "'");
+  }
+}
+
+}  // namespace
@@ -0,0 +1,128 @@
+#include "change_stats.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "test_repo.h"
+
+namespace {
+
+constexpr char kEmptyTree[] = "4b825dc642cb6eb9a060e54bf8d69288fbee4904";
+
+// Totals of `git diff --numstat` between |parent| and |commit|.
+ChangeStats GitNumstat(TestRepo* repo,
+                       const std::string& parent,
+                       const std::string& commit) {
+  ChangeStats stats;
+  std::istringstream lines(
+      repo->Git("diff --numstat " + parent + " " + commit));
+  std::string line;
+  while (std::getline(lines, line)) {
+    stats.files++;
+    if (line.compare(0, 4, "-\t-\t") == 0) {
+      stats.binary_files++;
+      continue;
+    }
+    char* end;
+    stats.added += std::strtoull(line.c_str(), &end, 10);
+    stats.removed += std::strtoull(end + 1, nullptr, 10);
+  }
+  return stats;
+}
+
+// First |key| number field in |json| at or after |from|.
+uint64_t JsonUint(const std::string& json,
+                  size_t from,
+                  const std::string& key) {
+  const size_t at = json.find("\"" + key + "\":", from);
+  if (at == std::string::npos) return UINT64_MAX;
+  return std::strtoull(json.c_str() + at + key.size() + 3, nullptr, 10);
+}
+
+TEST(ChangeStatsTest, MatchesGitDiffNumstat) {
+  TestRepo repo;
+  std::string numbers;
+  for (int i = 1; i <= 40; i++) numbers += std::to_string(i) + "\n";
+  repo.Write("a.txt", numbers);
+  repo.Write("b.txt", "one\ntwo\nthree");
+  repo.Write("blob.bin", std::string("\0\1\2\3", 4));
+  repo.Write("dir/keep.txt", "keep\n");
+  repo.Commit("root", "1600000000 +0000");
+
+  // Edits, a line losing its newline, a binary change and a new file.
+  std::string edited = "0\n" + numbers.substr(numbers.find("3\n"));
+  edited.replace(edited.find("20\n"), 3, "twenty\nmore\n");
+  repo.Write("a.txt", edited);
+  repo.Write("b.txt", "one\ntwo\nthree\n");
+  repo.Write("blob.bin", std::string("\0\1\2\4", 4));
+  repo.Write("dir/new.txt", "x\ny\n");
+  repo.Commit("edit", "1600000060 +0000");
+
+  // Exact renames of a text and a binary file, a deletion, and a mode
+  // change.
+  repo.Git("mv a.txt renamed.txt");
+  repo.Git("mv blob.bin moved.bin");
+  repo.Git("rm -q dir/keep.txt");
+  Shell("chmod +x '" + repo.path() + "/b.txt'");
+  repo.Commit("rename", "1600000120 +0000");
+
+  // A rename with edits: git pairs it by similarity, the engine does not,
+  // so this commit is only checked for the file count difference below.
+  repo.Git("mv dir/new.txt dir/newer.txt");
+  repo.Write("dir/newer.txt", "x\ny\nz\n");
+  repo.Commit("rename and edit", "1600000180 +0000");
+
+  std::vector<std::string> ids;
+  std::istringstream log(repo.Git("log --reverse --format=%H"));
+  for (std::string id; std::getline(log, id);) ids.push_back(id);
+  ASSERT_EQ(ids.size(), 4u);
+  std::string joined;
+  for (const auto& id : ids) joined += id + "\n";
+  const std::string json = TakeBuffer(
+      gg_commit_stats(repo.path().c_str(), joined.c_str()));
+
+  for (size_t i = 0; i < ids.size(); i++) {
+    const size_t at = json.find("\"id\":\"" + ids[i] + "\"");
+    ASSERT_NE(at, std::string::npos) << json;
+    const ChangeStats want =
+        GitNumstat(&repo, i == 0 ? kEmptyTree : ids[i - 1], ids[i]);
+    if (i == 3) {
+      // Deletion plus addition instead of one renamed file: the line
+      // totals then count the whole file on both sides.
+      EXPECT_EQ(JsonUint(json, at, "files"), want.files + 1);
+      EXPECT_EQ(JsonUint(json, at, "added"), 3u);
+      EXPECT_EQ(JsonUint(json, at, "removed"), 2u);
+      continue;
+    }
+    EXPECT_EQ(JsonUint(json, at, "files"), want.files) << "commit " << i;
+    EXPECT_EQ(JsonUint(json, at, "binaryFiles"), want.binary_files)
+        << "commit " << i;
+    EXPECT_EQ(JsonUint(json, at, "added"), want.added) << "commit " << i;
+    EXPECT_EQ(JsonUint(json, at, "removed"), want.removed) << "commit " << i;
+  }
+  gg_reset();
+}
+
+TEST(ChangeStatsTest, CountLineChangesMatchesMinimalDiff) {
+  uint64_t added = 0, removed = 0;
+  CountLineChanges("a\nb\nc\n", "a\nx\nc\n", &added, &removed);
+  EXPECT_EQ(added, 1u);
+  EXPECT_EQ(removed, 1u);
+
+  added = removed = 0;
+  CountLineChanges("a\nb", "a\nb\n", &added, &removed);
+  EXPECT_EQ(added, 1u);
+  EXPECT_EQ(removed, 1u);
+
+  added = removed = 0;
+  CountLineChanges("", "a\nb\n", &added, &removed);
+  EXPECT_EQ(added, 2u);
+  EXPECT_EQ(removed, 0u);
+}
+
+}  // namespace
@@ -0,0 +1,33 @@
+#include "cli_args.h"
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(CliArgsTest, IntRejectsTrailingTextAndRange) {
+  int64_t v = -1;
+  EXPECT_TRUE(ParseIntArg("16", 1, 100, &v));
+  EXPECT_EQ(v, 16);
+  EXPECT_FALSE(ParseIntArg("4x", 1, 100, &v));
+  EXPECT_FALSE(ParseIntArg("", 1, 100, &v));
+  EXPECT_FALSE(ParseIntArg("abc", 0, 100, &v));
+  EXPECT_FALSE(ParseIntArg("0", 1, 100, &v));
+  EXPECT_FALSE(ParseIntArg("101", 1, 100, &v));
+  EXPECT_FALSE(ParseIntArg("99999999999999999999", 1, INT64_MAX, &v));
+  EXPECT_EQ(v, 16);
+}
+
+TEST(CliArgsTest, DoubleRejectsTrailingTextAndNonFinite) {
+  double v = -1;
+  EXPECT_TRUE(ParseDoubleArg("0.25", 0, 4, &v));
+  EXPECT_EQ(v, 0.25);
+  EXPECT_FALSE(ParseDoubleArg("1s", 0, 4, &v));
+  EXPECT_FALSE(ParseDoubleArg("nan", 0, 4, &v));
+  EXPECT_FALSE(ParseDoubleArg("inf", 0, 1e300, &v));
+  EXPECT_FALSE(ParseDoubleArg("4.5", 0, 4, &v));
+  EXPECT_EQ(v, 0.25);
+}
+
+}  // namespace
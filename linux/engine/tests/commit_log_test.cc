@@ -0,0 +1,96 @@
+#include "commit_log.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gitgraph_engine.h"
+#include "test_repo.h"
+
+namespace {
+
+// Raw "<seconds> <tz>" author dates, including negative offsets, local
+// times just before and after the epoch and a five-digit year.
+const char* const kRawDates[] = {
+    "1700000000 +0000",   "1700000000 -0045", "1700000000 +0530",
+    "1700000000 -1200",   "1700000000 +1400", "951782400 -0800",
+    "20000 -0530",        "0 -0330",          "3600 -1200",
+    "0 +0000",            "12600 -0330",      "253402300799 +1400",
+    "4102444800 -0000",
+};
+
+TEST(CommitLogTest, DatesMatchGitLogIso) {
+  TestRepo repo;
+  const std::string tree = repo.Git("mktree < /dev/null").substr(0, 40);
+  std::vector<std::string> ids;
+  for (size_t i = 0; i < sizeof(kRawDates) / sizeof(kRawDates[0]); i++) {
+    const std::string object = "tree " + tree + "\nauthor T <t@example.com> " +
+                               kRawDates[i] +
+                               "\ncommitter T <t@example.com> " +
+                               kRawDates[i] + "\n\ndate " +
+                               std::to_string(i) + "\n";
+    WriteFile(repo.path() + "/.git/commit.txt", object);
+    const std::string id =
+        repo.Git("hash-object -t commit -w .git/commit.txt").substr(0, 40);
+    repo.Git("update-ref refs/heads/d" + std::to_string(i) + " " + id);
+    ids.push_back(id);
+  }
+
+  CommitLog log;
+  std::string error;
+  ASSERT_TRUE(LoadCommitLog(repo.path(), &log, &error)) << error;
+  ASSERT_EQ(log.size(), ids.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    // git exits non-zero where it refuses to format a date; its empty
+    // output is then the expected value.
+    std::string want = repo.Git("log -1 --date=iso --format=%ad " + ids[i] +
+                                " 2>/dev/null || true");
+    if (!want.empty() && want.back() == '\n') want.pop_back();
+    const uint32_t row = log.Find(ids[i]);
+    ASSERT_NE(row, kNoCommit);
+    EXPECT_EQ(log.date(row), want) << kRawDates[i];
+  }
+}
+
+TEST(CommitLogTest, FfiFormatDateMatchesEngine) {
+  char buf[64];
+  const int64_t n = gg_format_date(1700000000, -45, buf, sizeof(buf));
+  EXPECT_EQ(std::string(buf, static_cast<size_t>(n)),
+            FormatIsoDate(1700000000, -45));
+  EXPECT_EQ(std::string(buf, static_cast<size_t>(n)),
+            "2023-11-14 21:28:20 -0045");
+  EXPECT_EQ(gg_format_date(1700000000, 0, buf, 4), 25);
+  EXPECT_EQ(gg_format_date(0, -210, buf, sizeof(buf)), 0);
+}
+
+TEST(CommitLogTest, FfiForgetReloadsOnlyThatRepo) {
+  TestRepo a;
+  TestRepo b;
+  for (TestRepo* repo : {&a, &b}) {
+    repo->Write("f", "1\n");
+    repo->Commit("one");
+  }
+  auto count = [](TestRepo* repo) {
+    const GgCommitStore* store =
+        gg_commit_store_open(repo->path().c_str(), nullptr);
+    EXPECT_NE(store, nullptr);
+    if (store == nullptr) return int64_t{-1};
+    const int64_t n = store->count;
+    gg_commit_store_close(store);
+    return n;
+  };
+  EXPECT_EQ(count(&a), 1);
+  EXPECT_EQ(count(&b), 1);
+  for (TestRepo* repo : {&a, &b}) {
+    repo->Write("f", "2\n");
+    repo->Commit("two", "1600000060 +0000");
+  }
+  gg_forget(a.path().c_str());
+  EXPECT_EQ(count(&a), 2);
+  EXPECT_EQ(count(&b), 1);  // Still the history loaded before.
+  gg_reset();
+}
+
+}  // namespace
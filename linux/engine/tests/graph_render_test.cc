@@ -0,0 +1,156 @@
+#include "graph_render.h"
+
+#include <png.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "commit_log.h"
+#include "history_window.h"
+#include "test_repo.h"
+#include "thread_pool.h"
+
+namespace {
+
+namespace rs = render_style;
+
+double LaneX(int32_t lane) {
+  return lane * rs::kLaneWidth + rs::kLaneWidth / 2;
+}
+
+double RowY(uint32_t row) {
+  return row * rs::kRowHeight + rs::kRowHeight / 2;
+}
+
+// Values of |count| numbers following each |prefix| in |text|, in order.
+std::vector<std::vector<double>> Scan(const std::string& text,
+                                      const std::string& prefix,
+                                      const char* format,
+                                      int count) {
+  std::vector<std::vector<double>> out;
+  for (size_t at = text.find(prefix); at != std::string::npos;
+       at = text.find(prefix, at + 1)) {
+    std::vector<double> v(8);
+    const int got = std::sscanf(text.c_str() + at + prefix.size(), format,
+                                &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+                                &v[6], &v[7]);
+    EXPECT_EQ(got, count) << text.substr(at, 80);
+    v.resize(count);
+    out.push_back(v);
+  }
+  return out;
+}
+
+class GraphRenderTest : public testing::Test {
+ protected:
+  void Load(uint32_t commits, uint32_t branches) {
+    repo_.FastImport(BranchyHistoryStream(commits, branches));
+    std::string error;
+    ASSERT_TRUE(LoadCommitLog(repo_.path(), &log_, &error)) << error;
+    layout_.reset(new HistoryLayout(log_));
+  }
+
+  TestRepo repo_;
+  TempDir out_;
+  CommitLog log_;
+  std::unique_ptr<HistoryLayout> layout_;
+  ThreadPool pool_{2};
+};
+
+TEST_F(GraphRenderTest, SvgMatchesLayout) {
+  // More rows than one serialization band, so band order is covered.
+  Load(5000, 4);
+  const uint32_t n = log_.size();
+  ASSERT_EQ(n, 5000u);
+  RenderOptions options;
+  options.labels = false;
+  const std::string path = out_.path() + "/graph.svg";
+  std::string error;
+  ASSERT_TRUE(WriteSvg(log_, *layout_, options, &pool_, path, &error))
+      << error;
+  const std::string svg = ReadFile(path);
+
+  const auto nodes = Scan(svg, "<circle ", "cx=\"%lf\" cy=\"%lf\"", 2);
+  ASSERT_EQ(nodes.size(), n);
+  for (uint32_t row = 0; row < n; row++) {
+    ASSERT_DOUBLE_EQ(nodes[row][0], LaneX(layout_->lane_of(row))) << row;
+    ASSERT_DOUBLE_EQ(nodes[row][1], RowY(row)) << row;
+  }
+
+  // One path per parent link, child end first, in child row order.
+  const auto paths = Scan(svg, "<path ",
+                          "d=\"M%lf %lfC%lf %lf %lf %lf %lf %lf\"", 8);
+  size_t i = 0;
+  for (uint32_t row = 0; row < n; row++) {
+    for (uint32_t parent : log_.parents(row)) {
+      if (parent == kNoCommit) continue;
+      ASSERT_LT(i, paths.size());
+      const std::vector<double>& p = paths[i++];
+      EXPECT_DOUBLE_EQ(p[0], LaneX(layout_->lane_of(row))) << row;
+      EXPECT_DOUBLE_EQ(p[1], RowY(row)) << row;
+      EXPECT_DOUBLE_EQ(p[6], LaneX(layout_->lane_of(parent))) << row;
+      EXPECT_DOUBLE_EQ(p[7], RowY(parent)) << row;
+      // Both inner control points sit halfway down.
+      EXPECT_DOUBLE_EQ(p[3], (RowY(row) + RowY(parent)) / 2) << row;
+      EXPECT_DOUBLE_EQ(p[5], p[3]) << row;
+    }
+  }
+  EXPECT_EQ(i, paths.size());
+
+  const auto size = Scan(svg, "viewBox=\"0 0 ", "%lf %lf", 2);
+  ASSERT_EQ(size.size(), 1u);
+  EXPECT_DOUBLE_EQ(size[0][0], (layout_->max_lane() + 1) * rs::kLaneWidth);
+  EXPECT_DOUBLE_EQ(size[0][1], n * rs::kRowHeight);
+}
+
+TEST_F(GraphRenderTest, PngTilesHaveANodeAtEveryRow) {
+  Load(300, 3);
+  const uint32_t n = log_.size();
+  RenderOptions options;
+  options.tile_height = 2000;
+  std::vector<std::string> files;
+  std::string error;
+  ASSERT_TRUE(WritePngTiles(log_, *layout_, options, &pool_,
+                            out_.path() + "/graph.png", &files, &error))
+      << error;
+  const uint32_t height = static_cast<uint32_t>(n * rs::kRowHeight);
+  ASSERT_EQ(files.size(), (height + 1999) / 2000);
+  EXPECT_EQ(files[0], out_.path() + "/graph-0000.png");
+
+  // Decode the tiles into one image and look at every node centre.
+  const uint32_t width =
+      static_cast<uint32_t>((layout_->max_lane() + 1) * rs::kLaneWidth);
+  std::vector<uint8_t> pixels;
+  for (const std::string& file : files) {
+    png_image image{};
+    image.version = PNG_IMAGE_VERSION;
+    ASSERT_TRUE(png_image_begin_read_from_file(&image, file.c_str()))
+        << file;
+    image.format = PNG_FORMAT_RGB;
+    ASSERT_EQ(image.width, width) << file;
+    const size_t at = pixels.size();
+    pixels.resize(at + PNG_IMAGE_SIZE(image));
+    ASSERT_TRUE(png_image_finish_read(&image, nullptr, pixels.data() + at, 0,
+                                      nullptr))
+        << file;
+  }
+  ASSERT_EQ(pixels.size(), size_t{width} * height * 3);
+  auto rgb = [&](double x, double y) {
+    const uint8_t* p =
+        &pixels[(static_cast<size_t>(y) * width + static_cast<size_t>(x)) * 3];
+    return uint32_t{p[0]} << 16 | uint32_t{p[1]} << 8 | p[2];
+  };
+  for (uint32_t row = 0; row < n; row++) {
+    EXPECT_EQ(rgb(LaneX(layout_->lane_of(row)), RowY(row)), rs::kNodeColor)
+        << "row " << row;
+  }
+  // The right edge of the first row is beyond every node and edge.
+  EXPECT_EQ(rgb(width - 1, 0), rs::kBackground);
+}
+
+}  // namespace
@@ -0,0 +1,128 @@
+#include "history_window.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "commit_log.h"
+#include "test_repo.h"
+
+namespace {
+
+// Spans two full checkpoint intervals and part of a third.
+constexpr uint32_t kCommits = 2 * kCheckpointInterval + 700;
+
+class HistoryLayoutTest : public testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    repo_ = new TestRepo();
+    repo_->FastImport(BranchyHistoryStream(kCommits, 6));
+    log_ = new CommitLog();
+    std::string error;
+    ASSERT_TRUE(LoadCommitLog(repo_->path(), log_, &error)) << error;
+    layout_ = new HistoryLayout(*log_);
+  }
+
+  static void TearDownTestSuite() {
+    delete layout_;
+    delete log_;
+    delete repo_;
+  }
+
+  static TestRepo* repo_;
+  static CommitLog* log_;
+  static HistoryLayout* layout_;
+};
+
+TestRepo* HistoryLayoutTest::repo_ = nullptr;
+CommitLog* HistoryLayoutTest::log_ = nullptr;
+HistoryLayout* HistoryLayoutTest::layout_ = nullptr;
+
+TEST_F(HistoryLayoutTest, CheckpointRestoreMatchesFullReplay) {
+  ASSERT_EQ(log_->size(), kCommits);
+  const uint32_t probes[] = {0,
+                             1,
+                             kCheckpointInterval - 1,
+                             kCheckpointInterval,
+                             kCheckpointInterval + 1,
+                             2 * kCheckpointInterval - 1,
+                             2 * kCheckpointInterval,
+                             2 * kCheckpointInterval + 1,
+                             kCommits - 1,
+                             kCommits};
+  size_t next = 0;
+  int32_t widest = 0;
+  std::vector<uint32_t> lanes;
+  for (uint32_t row = 0; row <= kCommits; row++) {
+    if (next < sizeof(probes) / sizeof(probes[0]) && probes[next] == row) {
+      EXPECT_EQ(layout_->LaneStateAt(row), lanes) << "row " << row;
+      next++;
+    }
+    if (row == kCommits) break;
+    const int32_t lane = HistoryLayout::Advance(log_->parents(row), row,
+                                                &lanes);
+    ASSERT_EQ(lane, layout_->lane_of(row)) << "row " << row;
+    widest = std::max(widest, static_cast<int32_t>(lanes.size()));
+  }
+  EXPECT_EQ(next, sizeof(probes) / sizeof(probes[0]));
+  // The fixture only exercises the restore if lanes are live across the
+  // checkpoints.
+  EXPECT_GT(widest, 2);
+  EXPECT_FALSE(layout_->LaneStateAt(kCheckpointInterval).empty());
+}
+
+TEST_F(HistoryLayoutTest, LaneStateAtClampsPastTheEnd) {
+  EXPECT_EQ(layout_->LaneStateAt(kCommits + 5),
+            layout_->LaneStateAt(kCommits));
+}
+
+size_t CountRows(const std::string& json) {
+  size_t count = 0;
+  for (size_t at = json.find("{\"row\":"); at != std::string::npos;
+       at = json.find("{\"row\":", at + 1)) {
+    count++;
+  }
+  return count;
+}
+
+TEST_F(HistoryLayoutTest, WindowIsClampedToTheHistory) {
+  const std::string total = "\"total\":" + std::to_string(kCommits);
+
+  std::string json = HistoryWindowJson(*log_, *layout_, 100, 50);
+  EXPECT_NE(json.find(total), std::string::npos);
+  EXPECT_NE(json.find("\"start\":100,"), std::string::npos);
+  EXPECT_EQ(CountRows(json), 50u);
+
+  json = HistoryWindowJson(*log_, *layout_, kCommits - 10, 50);
+  EXPECT_EQ(CountRows(json), 10u);
+
+  json = HistoryWindowJson(*log_, *layout_, kCommits + 100, 50);
+  EXPECT_NE(json.find("\"start\":" + std::to_string(kCommits) + ","),
+            std::string::npos);
+  EXPECT_EQ(CountRows(json), 0u);
+
+  json = HistoryWindowJson(*log_, *layout_, 5, UINT32_MAX);
+  EXPECT_EQ(CountRows(json), kCommits - 5);
+}
+
+TEST_F(HistoryLayoutTest, FfiWindowClampsNegativeArguments) {
+  const char* path = repo_->path().c_str();
+  std::string json = TakeBuffer(gg_history_window(path, -5, 3));
+  EXPECT_NE(json.find("\"start\":0,"), std::string::npos) << json;
+  EXPECT_EQ(CountRows(json), 3u);
+
+  json = TakeBuffer(gg_history_window(path, 0, -1));
+  EXPECT_EQ(CountRows(json), 0u);
+
+  json = TakeBuffer(gg_history_window(path, INT64_MAX, 10));
+  EXPECT_EQ(CountRows(json), 0u);
+
+  json = TakeBuffer(gg_history_window("/nonexistent/repo", 0, 10));
+  EXPECT_EQ(json.compare(0, 9, "{\"error\":"), 0) << json;
+  gg_reset();
+}
+
+}  // namespace
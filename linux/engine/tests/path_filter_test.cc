@@ -0,0 +1,132 @@
+#include "path_filter.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "test_repo.h"
+
+namespace {
+
+constexpr char kBloomFile[] = "/.git/gitgraph/changed-paths.bloom";
+
+std::vector<std::string> GitLogIds(TestRepo* repo, const std::string& path) {
+  std::vector<std::string> ids;
+  const std::string out = repo->Git("log --format=%H -- " + path);
+  for (size_t at = 0; at < out.size();) {
+    const size_t end = out.find('\n', at);
+    ids.push_back(out.substr(at, end - at));
+    at = end + 1;
+  }
+  return ids;
+}
+
+std::string FilterPath(TestRepo* repo, const std::string& path) {
+  return TakeBuffer(gg_path_filter(repo->path().c_str(), path.c_str()));
+}
+
+// Number of filters in the engine's persisted file.
+uint32_t BloomFileCount(TestRepo* repo) {
+  const std::string b = ReadFile(repo->path() + kBloomFile);
+  if (b.size() < 24) return 0;
+  uint32_t count = 0;
+  for (int i = 3; i >= 0; i--) {
+    count = count << 8 | static_cast<uint8_t>(b[20 + i]);
+  }
+  return count;
+}
+
+class PathFilterTest : public testing::Test {
+ protected:
+  void TearDown() override { gg_reset(); }
+
+  TestRepo repo_;
+};
+
+TEST_F(PathFilterTest, ModeOnlyChangeIsNotTreesame) {
+  repo_.Write("run.sh", "echo hi\n");
+  repo_.Write("other.txt", "1\n");
+  repo_.Commit("add");
+  Shell("chmod +x '" + repo_.path() + "/run.sh'");
+  repo_.Commit("make executable", "1600000100 +0000");
+  repo_.Write("other.txt", "2\n");
+  repo_.Commit("unrelated", "1600000200 +0000");
+
+  const std::string json = FilterPath(&repo_, "run.sh");
+  EXPECT_EQ(JsonStrings(json, "id"), GitLogIds(&repo_, "run.sh")) << json;
+  EXPECT_EQ(JsonStrings(json, "id").size(), 2u);
+}
+
+TEST_F(PathFilterTest, RewrittenFilterFileCountsAndDropsStaleCommits) {
+  for (int i = 0; i < 4; i++) {
+    repo_.Write("f" + std::to_string(i), "x\n");
+    repo_.Commit("c" + std::to_string(i),
+                 std::to_string(1600000000 + i * 60) + " +0000");
+  }
+  std::string json = FilterPath(&repo_, "f1");
+  EXPECT_NE(json.find("\"engine\":0,\"computed\":4"), std::string::npos)
+      << json;
+  EXPECT_EQ(BloomFileCount(&repo_), 4u);
+
+  // Two new commits: the four on disk are reused, not counted again.
+  gg_reset();
+  repo_.Write("f1", "y\n");
+  repo_.Commit("c4", "1600001000 +0000");
+  repo_.Write("f5", "x\n");
+  repo_.Commit("c5", "1600001060 +0000");
+  json = FilterPath(&repo_, "f1");
+  EXPECT_NE(json.find("\"engine\":4,\"computed\":2"), std::string::npos)
+      << json;
+  EXPECT_EQ(JsonStrings(json, "id"), GitLogIds(&repo_, "f1"));
+  EXPECT_EQ(BloomFileCount(&repo_), 6u);
+
+  // Drop three commits and add one: the rewrite keeps only live commits.
+  gg_reset();
+  repo_.Git("reset -q --hard HEAD~3");
+  repo_.Git("reflog expire --expire=now --all");
+  repo_.Write("f6", "x\n");
+  repo_.Commit("c6", "1600002000 +0000");
+  json = FilterPath(&repo_, "f1");
+  EXPECT_NE(json.find("\"engine\":3,\"computed\":1"), std::string::npos)
+      << json;
+  EXPECT_EQ(BloomFileCount(&repo_), 4u);
+}
+
+TEST_F(PathFilterTest, InconsistentCommitGraphIsIgnored) {
+  for (int i = 0; i < 3; i++) {
+    repo_.Write("f" + std::to_string(i), "x\n");
+    repo_.Commit("c" + std::to_string(i),
+                 std::to_string(1600000000 + i * 60) + " +0000");
+  }
+  repo_.Git("commit-graph write --reachable --changed-paths");
+  const std::string graph = repo_.path() + "/.git/objects/info/commit-graph";
+  std::string b = ReadFile(graph);
+  ASSERT_GT(b.size(), 8u);
+
+  std::string json = FilterPath(&repo_, "f1");
+  EXPECT_NE(json.find("\"commitGraph\":3,"), std::string::npos) << json;
+  gg_reset();
+
+  // Claim one more commit than the lookup and index chunks hold.
+  size_t fanout = 0;
+  for (size_t e = 8; e + 12 <= b.size(); e += 12) {
+    if (b.compare(e, 4, "OIDF") == 0) {
+      for (int i = 4; i < 12; i++) {
+        fanout = fanout << 8 | static_cast<uint8_t>(b[e + i]);
+      }
+      break;
+    }
+  }
+  ASSERT_NE(fanout, 0u);
+  b[fanout + 255 * 4 + 3] = static_cast<char>(b[fanout + 255 * 4 + 3] + 1);
+  Shell("chmod u+w '" + graph + "'");
+  WriteFile(graph, b);
+
+  json = FilterPath(&repo_, "f1");
+  EXPECT_NE(json.find("\"commitGraph\":0,"), std::string::npos) << json;
+  EXPECT_EQ(JsonStrings(json, "id"), GitLogIds(&repo_, "f1"));
+}
+
+}  // namespace
@@ -0,0 +1,152 @@
+#include "search_index.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "commit_log.h"
+#include "test_repo.h"
+
+namespace {
+
+std::string Lower(std::string s) {
+  for (char& c : s) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+  }
+  return s;
+}
+
+std::vector<std::string> Terms(const std::string& query) {
+  std::vector<std::string> terms;
+  std::string current;
+  for (char c : query + " ") {
+    if (c == ' ' || c == '\t') {
+      if (!current.empty()) terms.push_back(Lower(current));
+      current.clear();
+    } else {
+      current.push_back(c);
+    }
+  }
+  return terms;
+}
+
+// Search() by scanning every row.
+std::vector<SearchIndex::Match> BruteForce(const CommitLog& log,
+                                           const std::string& query) {
+  std::vector<SearchIndex::Match> matches;
+  const std::vector<std::string> terms = Terms(query);
+  for (uint32_t row = 0; row < log.size(); row++) {
+    uint8_t fields = 0;
+    bool all = !terms.empty();
+    for (const std::string& term : terms) {
+      uint8_t f = 0;
+      if (Lower(std::string(log.subject(row))).find(term) !=
+          std::string::npos) {
+        f |= SearchIndex::kSubject;
+      }
+      if (Lower(std::string(log.author(row))).find(term) !=
+          std::string::npos) {
+        f |= SearchIndex::kAuthor;
+      }
+      for (uint32_t ref : log.refs(row)) {
+        if (Lower(std::string(log.string(ref))).find(term) !=
+            std::string::npos) {
+          f |= SearchIndex::kRefs;
+        }
+      }
+      if (f == 0) all = false;
+      fields |= f;
+    }
+    if (all) matches.push_back({row, fields});
+  }
+  return matches;
+}
+
+void ExpectSameAsScan(const CommitLog& log,
+                      const SearchIndex& index,
+                      const std::string& query) {
+  const std::vector<SearchIndex::Match> want = BruteForce(log, query);
+  size_t total = 0;
+  size_t candidates = 0;
+  const std::vector<SearchIndex::Match> got =
+      index.Search(query, SIZE_MAX, &total, &candidates);
+  ASSERT_EQ(got.size(), want.size()) << query;
+  EXPECT_EQ(total, want.size()) << query;
+  EXPECT_GE(candidates, total) << query;
+  for (size_t i = 0; i < got.size(); i++) {
+    EXPECT_EQ(got[i].row, want[i].row) << query;
+    EXPECT_EQ(got[i].fields, want[i].fields) << query << " row " << got[i].row;
+  }
+
+  // A limit trims the list but not the count.
+  const size_t limit = want.size() / 2;
+  const std::vector<SearchIndex::Match> first =
+      index.Search(query, limit, &total, &candidates);
+  ASSERT_EQ(first.size(), limit) << query;
+  EXPECT_EQ(total, want.size()) << query;
+  for (size_t i = 0; i < first.size(); i++) {
+    EXPECT_EQ(first[i].row, want[i].row) << query;
+  }
+}
+
+TEST(SearchIndexTest, MatchesSubstringScan) {
+  // Long enough that the posting lists of rarer trigrams ("123") have
+  // gaps of more than one varint byte.
+  TestRepo repo;
+  repo.FastImport(BranchyHistoryStream(3000, 5));
+  CommitLog log;
+  std::string error;
+  ASSERT_TRUE(LoadCommitLog(repo.path(), &log, &error)) << error;
+  const SearchIndex index(log);
+
+  for (const std::string query :
+       {"change", "CHANGE 123", "nge 29", "change 1 2", "123 change",
+        "topic-3", "main", "TOPIC-2 change", "change 2999", "t change",
+        "change  \t 77", "no such text", "123 456"}) {
+    ExpectSameAsScan(log, index, query);
+  }
+}
+
+TEST(SearchIndexTest, FoldsAsciiAndMatchesUtf8Bytes) {
+  TestRepo repo;
+  repo.Write("a", "1\n");
+  repo.Commit("Fix Parser for README");
+  repo.Write("a", "2\n");
+  repo.Commit("修复年度报告格式", "1600000060 +0000");
+  repo.Git("tag Release-1.0");
+  CommitLog log;
+  std::string error;
+  ASSERT_TRUE(LoadCommitLog(repo.path(), &log, &error)) << error;
+  const SearchIndex index(log);
+
+  for (const std::string query :
+       {"fix parser", "PARSER", "readme fix", "年度报告", "报告 格式",
+        "release-1.0", "RELEASE", "格"}) {
+    ExpectSameAsScan(log, index, query);
+  }
+}
+
+TEST(SearchIndexTest, ShortTermsAloneMatchNothing) {
+  TestRepo repo;
+  repo.FastImport(BranchyHistoryStream(200, 3));
+  CommitLog log;
+  std::string error;
+  ASSERT_TRUE(LoadCommitLog(repo.path(), &log, &error)) << error;
+  const SearchIndex index(log);
+
+  for (const std::string query : {"", " ", "c", "ch", "ch 1 2"}) {
+    EXPECT_FALSE(SearchIndex::IsSearchable(query)) << query;
+    size_t total = 1;
+    size_t candidates = 1;
+    EXPECT_TRUE(index.Search(query, 10, &total, &candidates).empty());
+    EXPECT_EQ(total, 0u);
+    EXPECT_EQ(candidates, 0u) << "short terms must not scan the log";
+  }
+  // With a longer term, short ones still narrow the result.
+  EXPECT_TRUE(SearchIndex::IsSearchable("ch 1 change"));
+  ExpectSameAsScan(log, index, "ch 1 change");
+}
+
+}  // namespace
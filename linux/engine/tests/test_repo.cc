@@ -0,0 +1,168 @@
+#include "test_repo.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Identity and clock for every git command, so ids are reproducible.
+constexpr char kGitEnv[] =
+    "GIT_CONFIG_NOSYSTEM=1 GIT_CONFIG_GLOBAL=/dev/null "
+    "GIT_AUTHOR_NAME=Tester GIT_AUTHOR_EMAIL=tester@example.com "
+    "GIT_COMMITTER_NAME=Tester GIT_COMMITTER_EMAIL=tester@example.com ";
+
+std::string Quote(const std::string& s) {
+  std::string out = "'";
+  for (char c : s) {
+    if (c == '\'') {
+      out += "'\\''";
+    } else {
+      out.push_back(c);
+    }
+  }
+  return out + "'";
+}
+
+}  // namespace
+
+TempDir::TempDir() {
+  const char* base = getenv("TMPDIR");
+  std::string pattern =
+      std::string(base != nullptr && *base != 0 ? base : "/tmp") +
+      "/gitgraph-test-XXXXXX";
+  std::vector<char> buf(pattern.begin(), pattern.end());
+  buf.push_back(0);
+  if (mkdtemp(buf.data()) == nullptr) {
+    ADD_FAILURE() << "mkdtemp failed for " << pattern;
+    return;
+  }
+  path_ = buf.data();
+}
+
+TempDir::~TempDir() {
+  if (path_.empty()) return;
+  // chmod first: a restored snapshot may contain read-only directories.
+  Shell("chmod -R u+rwx " + Quote(path_) + " && rm -rf " + Quote(path_));
+}
+
+void WriteFile(const std::string& path, const std::string& content) {
+  const size_t slash = path.rfind('/');
+  if (slash != std::string::npos && slash > 0) {
+    Shell("mkdir -p " + Quote(path.substr(0, slash)));
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << content;
+  EXPECT_TRUE(out.good()) << "cannot write " << path;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream s;
+  s << in.rdbuf();
+  return s.str();
+}
+
+std::string Shell(const std::string& command) {
+  FILE* p = popen(command.c_str(), "r");
+  if (p == nullptr) {
+    ADD_FAILURE() << "cannot run " << command;
+    return "";
+  }
+  std::string out;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), p)) > 0) out.append(buf, n);
+  const int status = pclose(p);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0)
+      << "failed: " << command;
+  return out;
+}
+
+std::string TakeBuffer(GgBuffer buffer) {
+  std::string s(reinterpret_cast<const char*>(buffer.data),
+                static_cast<size_t>(buffer.size));
+  gg_free(buffer.data);
+  return s;
+}
+
+std::vector<std::string> JsonStrings(const std::string& json,
+                                     const std::string& key) {
+  const std::string needle = "\"" + key + "\":\"";
+  std::vector<std::string> out;
+  for (size_t at = json.find(needle); at != std::string::npos;
+       at = json.find(needle, at)) {
+    at += needle.size();
+    const size_t end = json.find('"', at);
+    out.push_back(json.substr(at, end - at));
+  }
+  return out;
+}
+
+TestRepo::TestRepo() {
+  Git("init -q -b main");
+}
+
+std::string TestRepo::Git(const std::string& args) {
+  return Shell(std::string(kGitEnv) + "git -C " + Quote(path()) + " " + args);
+}
+
+void TestRepo::Write(const std::string& file, const std::string& content) {
+  WriteFile(path() + "/" + file, content);
+}
+
+void TestRepo::Commit(const std::string& message, const std::string& when) {
+  Git("add -A");
+  Shell(std::string(kGitEnv) + "GIT_AUTHOR_DATE=" + Quote(when) +
+        " GIT_COMMITTER_DATE=" + Quote(when) + " git -C " + Quote(path()) +
+        " commit -q --allow-empty -m " + Quote(message));
+}
+
+void TestRepo::FastImport(const std::string& stream) {
+  const std::string file = path() + "/.git/test.stream";
+  WriteFile(file, stream);
+  Git("fast-import --quiet < " + Quote(file));
+  std::remove(file.c_str());
+  Git("symbolic-ref HEAD refs/heads/main");
+  Git("reset -q --hard");
+}
+
+std::string BranchyHistoryStream(uint32_t commits, uint32_t branches) {
+  std::mt19937 rng(commits * 31 + branches);
+  std::vector<uint32_t> heads(branches, 0);
+  std::string out;
+  char line[160];
+  for (uint32_t i = 1; i <= commits; i++) {
+    uint32_t b = rng() % (2 * branches);
+    if (b >= branches || heads[0] == 0) b = 0;
+    const std::string ref = b == 0 ? "main" : "topic-" + std::to_string(b);
+    const std::string message = "change " + std::to_string(i) + "\n";
+    std::snprintf(line, sizeof(line),
+                  "author T <t@example.com> %u +0000\n"
+                  "committer T <t@example.com> %u +0000\n",
+                  1600000000u + i * 60, 1600000000u + i * 60);
+    out += "commit refs/heads/" + ref + "\nmark :" + std::to_string(i) +
+           "\n" + line + "data " + std::to_string(message.size()) + "\n" +
+           message;
+    const uint32_t from = heads[b] != 0 ? heads[b] : heads[0];
+    if (from != 0) out += "from :" + std::to_string(from) + "\n";
+    if (b == 0 && rng() % 3 == 0) {
+      const uint32_t other = 1 + rng() % (branches - 1);
+      if (heads[other] != 0) {
+        out += "merge :" + std::to_string(heads[other]) + "\n";
+      }
+    }
+    out += "M 644 inline " + ref + ".txt\ndata " +
+           std::to_string(message.size()) + "\n" + message + "\n";
+    heads[b] = i;
+  }
+  return out;
+}
@@ -0,0 +1,65 @@
+#ifndef ENGINE_TESTS_TEST_REPO_H_
+#define ENGINE_TESTS_TEST_REPO_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gitgraph_engine.h"
+
+// Scratch directory under $TMPDIR, removed with everything in it when the
+// object goes away.
+class TempDir {
+ public:
+  TempDir();
+  ~TempDir();
+  TempDir(const TempDir&) = delete;
+  TempDir& operator=(const TempDir&) = delete;
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+// Writes |content| to |path|, creating missing parent directories.
+void WriteFile(const std::string& path, const std::string& content);
+std::string ReadFile(const std::string& path);
+
+// Runs a shell command and returns its standard output; the calling test
+// fails when it exits non-zero.
+std::string Shell(const std::string& command);
+
+// Copies a buffer returned by the C API and frees it.
+std::string TakeBuffer(GgBuffer buffer);
+
+// Values of every |key| string field in |json|, in order.
+std::vector<std::string> JsonStrings(const std::string& json,
+                                     const std::string& key);
+
+// Scratch git repository with a fixed identity and clock, so commit ids
+// are the same on every run.
+class TestRepo {
+ public:
+  TestRepo();
+
+  const std::string& path() const { return dir_.path(); }
+
+  // `git <args>` in the repository; |args| is passed through the shell.
+  std::string Git(const std::string& args);
+  void Write(const std::string& file, const std::string& content);
+  // Stages everything and commits it at |when| ("<unix seconds> <tz>").
+  void Commit(const std::string& message,
+              const std::string& when = "1600000000 +0000");
+  void FastImport(const std::string& stream);
+
+ private:
+  TempDir dir_;
+};
+
+// fast-import stream of |commits| commits over |branches| branches that
+// fork from main and keep merging back into it, so the layout has many
+// long-lived lanes.
+std::string BranchyHistoryStream(uint32_t commits, uint32_t branches);
+
+#endif  // ENGINE_TESTS_TEST_REPO_H_
@@ -0,0 +1,119 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+
+// Chunks per worker: enough slack for stealing to even out the load.
+constexpr size_t kChunksPerWorker = 8;
+
+}  // namespace
+
+struct ThreadPool::Batch {
+  const std::function<void(size_t, size_t)>* fn;
+  std::mutex mutex;
+  size_t remaining;  // Guarded by mutex.
+  std::condition_variable done;
+};
+
+ThreadPool::ThreadPool(size_t threads) {
+  threads = std::max<size_t>(threads, 1);
+  for (size_t i = 0; i < threads; i++) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& t : workers_) t.join();
+}
+
+ThreadPool& ThreadPool::Shared() {
+  // Leaked on purpose: joining workers from a static destructor at process
+  // exit can deadlock inside the Dart VM's shutdown.
+  static ThreadPool* pool =
+      new ThreadPool(std::max(1u, std::thread::hardware_concurrency()));
+  return *pool;
+}
+
+void ThreadPool::ParallelFor(size_t count,
+                             const std::function<void(size_t, size_t)>& fn) {
+  if (count == 0) return;
+  Batch batch;
+  batch.fn = &fn;
+  const size_t chunks = std::min(count, size() * kChunksPerWorker);
+  const size_t chunk_size = (count + chunks - 1) / chunks;
+  const size_t tasks = (count + chunk_size - 1) / chunk_size;
+  batch.remaining = tasks;
+  // Count before publishing, so a busy worker that grabs a task early can
+  // never drive queued_ below zero.
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    queued_ += tasks;
+  }
+  for (size_t t = 0; t < tasks; t++) {
+    const size_t begin = t * chunk_size;
+    Queue& q = *queues_[t % queues_.size()];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back({begin, std::min(count, begin + chunk_size), &batch});
+  }
+  wake_.notify_all();
+
+  std::unique_lock<std::mutex> lock(batch.mutex);
+  batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+}
+
+bool ThreadPool::TakeTask(size_t worker, Task* task) {
+  {
+    Queue& own = *queues_[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      *task = own.tasks.back();
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); i++) {
+    Queue& victim = *queues_[(worker + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      *task = victim.tasks.front();
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(size_t worker) {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      wake_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+      if (stopping_) return;
+    }
+    Task task;
+    if (!TakeTask(worker, &task)) {
+      // Another worker got there first; its decrement is on the way.
+      std::this_thread::yield();
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      queued_--;
+    }
+    for (size_t i = task.begin; i < task.end; i++) (*task.batch->fn)(i, worker);
+    // Decrement under the lock: the waiter owns |batch| and may destroy it
+    // as soon as it observes zero.
+    Batch* batch = task.batch;
+    std::lock_guard<std::mutex> lock(batch->mutex);
+    if (--batch->remaining == 0) batch->done.notify_all();
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef ENGINE_THREAD_POOL_H_
+#define ENGINE_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool with one task deque per worker. Workers take work from the
+// back of their own deque and steal from the front of the others', so a
+// batch whose items vary wildly in cost (a one-line fix next to a vendored
+// SDK import) still keeps every core busy.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Process-wide pool sized to the hardware concurrency.
+  static ThreadPool& Shared();
+
+  size_t size() const { return workers_.size(); }
+
+  // Calls fn(index, worker) for every index in [0, count) and returns once
+  // all calls have finished. |worker| is in [0, size()) and identifies the
+  // executing thread, so callers can keep per-thread state such as an
+  // ObjectReader. Must not be called from inside a pool task.
+  void ParallelFor(size_t count,
+                   const std::function<void(size_t, size_t)>& fn);
+
+ private:
+  struct Batch;
+  struct Task {
+    size_t begin;
+    size_t end;
+    Batch* batch;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void WorkerLoop(size_t worker);
+  bool TakeTask(size_t worker, Task* task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  size_t queued_ = 0;  // Guarded by wake_mutex_.
+  bool stopping_ = false;
+};
+
+#endif  // ENGINE_THREAD_POOL_H_
@@ -0,0 +1,176 @@
+#include "tree_diff.h"
+
+#include <algorithm>
+
+namespace {
+
+const Oid kZeroOid{};
+
+// Git sorts tree entries by name, comparing a subtree as if its name ended
+// in '/'.
+int CompareEntries(const TreeEntry& a, const TreeEntry& b) {
+  const size_t n = std::min(a.name.size(), b.name.size());
+  const int c = std::memcmp(a.name.data(), b.name.data(), n);
+  if (c != 0) return c;
+  const unsigned char ca = a.name.size() > n ? a.name[n]
+                           : a.is_tree()     ? '/'
+                                             : 0;
+  const unsigned char cb = b.name.size() > n ? b.name[n]
+                           : b.is_tree()     ? '/'
+                                             : 0;
+  return static_cast<int>(ca) - static_cast<int>(cb);
+}
+
+bool ReadTree(ObjectReader* reader,
+              const Oid* oid,
+              std::vector<TreeEntry>* entries) {
+  entries->clear();
+  if (oid == nullptr) return true;
+  std::string type;
+  std::string data;
+  if (!reader->Read(*oid, &type, &data) || type != "tree") return false;
+  return ParseTree(data, entries);
+}
+
+bool DiffTreesAt(ObjectReader* reader,
+                 const Oid* old_tree,
+                 const Oid* new_tree,
+                 const std::string& prefix,
+                 const TreeChangeCallback& on_change) {
+  std::vector<TreeEntry> olds;
+  std::vector<TreeEntry> news;
+  if (!ReadTree(reader, old_tree, &olds)) return false;
+  if (!ReadTree(reader, new_tree, &news)) return false;
+
+  // Reports one side's entry as added or removed, recursing into trees.
+  auto one_sided = [&](const TreeEntry& e, bool is_old) {
+    const std::string path = prefix + e.name;
+    if (e.is_tree()) {
+      return DiffTreesAt(reader, is_old ? &e.oid : nullptr,
+                         is_old ? nullptr : &e.oid, path + "/", on_change);
+    }
+    on_change(path, is_old ? &e : nullptr, is_old ? nullptr : &e);
+    return true;
+  };
+
+  size_t i = 0;
+  size_t j = 0;
+  while (i < olds.size() || j < news.size()) {
+    int cmp;
+    if (i == olds.size()) {
+      cmp = 1;
+    } else if (j == news.size()) {
+      cmp = -1;
+    } else if (olds[i].name == news[j].name) {
+      cmp = 0;
+    } else {
+      cmp = CompareEntries(olds[i], news[j]);
+    }
+    if (cmp < 0) {
+      if (!one_sided(olds[i++], true)) return false;
+      continue;
+    }
+    if (cmp > 0) {
+      if (!one_sided(news[j++], false)) return false;
+      continue;
+    }
+    const TreeEntry& a = olds[i++];
+    const TreeEntry& b = news[j++];
+    if (a.oid == b.oid && a.mode == b.mode) continue;
+    if (a.is_tree() && b.is_tree()) {
+      if (!DiffTreesAt(reader, &a.oid, &b.oid, prefix + a.name + "/",
+                       on_change)) {
+        return false;
+      }
+    } else if (a.is_tree() != b.is_tree()) {
+      if (!one_sided(a, true) || !one_sided(b, false)) return false;
+    } else {
+      on_change(prefix + a.name, &a, &b);
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ParseTree(const std::string& data, std::vector<TreeEntry>* entries) {
+  size_t pos = 0;
+  while (pos < data.size()) {
+    const size_t sp = data.find(' ', pos);
+    if (sp == std::string::npos) return false;
+    const size_t nul = data.find('\0', sp + 1);
+    if (nul == std::string::npos || nul + 1 + kOidSize > data.size()) {
+      return false;
+    }
+    TreeEntry e;
+    for (size_t k = pos; k < sp; k++) e.mode = e.mode * 8 + (data[k] - '0');
+    e.name.assign(data, sp + 1, nul - sp - 1);
+    std::memcpy(e.oid.data(), data.data() + nul + 1, kOidSize);
+    entries->push_back(std::move(e));
+    pos = nul + 1 + kOidSize;
+  }
+  return true;
+}
+
+bool DiffTrees(ObjectReader* reader,
+               const Oid* old_tree,
+               const Oid* new_tree,
+               const TreeChangeCallback& on_change) {
+  if (old_tree != nullptr && new_tree != nullptr && *old_tree == *new_tree) {
+    return true;
+  }
+  return DiffTreesAt(reader, old_tree, new_tree, "", on_change);
+}
+
+PathResolver::PathResolver(ObjectReader* reader, const std::string& path)
+    : reader_(reader) {
+  size_t start = 0;
+  while (start < path.size()) {
+    size_t slash = path.find('/', start);
+    if (slash == std::string::npos) slash = path.size();
+    if (slash > start) components_.push_back(path.substr(start, slash - start));
+    start = slash + 1;
+  }
+  memo_.resize(components_.size());
+}
+
+bool PathResolver::Resolve(const Oid& root,
+                           Oid* out,
+                           uint32_t* mode,
+                           std::string* error) {
+  Oid cur = root;
+  uint32_t cur_mode = 040000;
+  std::vector<TreeEntry> entries;
+  for (size_t depth = 0; depth < components_.size(); depth++) {
+    auto& memo = memo_[depth];
+    auto it = memo.find(cur);
+    if (it == memo.end()) {
+      std::string type;
+      std::string data;
+      Found found = {kZeroOid, 0};
+      if (!reader_->Read(cur, &type, &data)) {
+        *error = reader_->error().empty() ? "missing tree " + OidToHex(cur)
+                                          : reader_->error();
+        return false;
+      }
+      // A blob where a directory was expected means the path is absent.
+      if (type == "tree") {
+        entries.clear();
+        ParseTree(data, &entries);
+        for (const auto& e : entries) {
+          if (e.name != components_[depth]) continue;
+          if (depth + 1 < components_.size() && !e.is_tree()) break;
+          found = {e.oid, e.mode};
+          break;
+        }
+      }
+      it = memo.emplace(cur, found).first;
+    }
+    if (it->second.oid == kZeroOid) return false;
+    cur = it->second.oid;
+    cur_mode = it->second.mode;
+  }
+  *out = cur;
+  *mode = cur_mode;
+  return true;
+}
@@ -0,0 +1,61 @@
+#ifndef ENGINE_TREE_DIFF_H_
+#define ENGINE_TREE_DIFF_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "object_reader.h"
+#include "oid.h"
+
+struct TreeEntry {
+  uint32_t mode = 0;
+  std::string name;
+  Oid oid{};
+
+  bool is_tree() const { return mode == 040000; }
+};
+
+// Parses a raw tree object into its entries, in git's stored order.
+bool ParseTree(const std::string& data, std::vector<TreeEntry>* entries);
+
+// Reported once per changed non-tree path. Exactly one of the entries is
+// null for an addition or deletion.
+using TreeChangeCallback = std::function<void(const std::string& path,
+                                              const TreeEntry* old_entry,
+                                              const TreeEntry* new_entry)>;
+
+// Walks two trees in lockstep, descending only into subtrees whose oids
+// differ. A null tree stands for the empty tree.
+bool DiffTrees(ObjectReader* reader,
+               const Oid* old_tree,
+               const Oid* new_tree,
+               const TreeChangeCallback& on_change);
+
+// Resolves one fixed path in many root trees. Results are memoized per
+// (depth, tree oid), so commits that share unchanged subtrees along the
+// path cost no extra object reads.
+class PathResolver {
+ public:
+  PathResolver(ObjectReader* reader, const std::string& path);
+
+  // Looks up the path in |root| and stores its oid and mode. Returns false
+  // when the path does not exist; a read error is reported through |error|.
+  bool Resolve(const Oid& root, Oid* out, uint32_t* mode, std::string* error);
+
+ private:
+  struct Found {
+    Oid oid;
+    uint32_t mode;
+  };
+
+  ObjectReader* reader_;
+  std::vector<std::string> components_;
+  // memo_[depth][tree] is the entry for components_[depth] inside tree, with
+  // the zero oid when it is absent.
+  std::vector<std::unordered_map<Oid, Found, OidHash>> memo_;
+};
+
+#endif  // ENGINE_TREE_DIFF_H_
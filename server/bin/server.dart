@@ -93,6 +93,7 @@ Future<void> main(List<String> args) async {
     final data = jsonDecode(body) as Map<String, dynamic>;
     final repoPath = _sanitizePath(data['repoPath'] as String?);
     final limit = data['limit'] is int ? data['limit'] as int : null;
+    final path = data['path'] is String ? (data['path'] as String).trim() : '';
     if (repoPath.isEmpty) {
       return _cors(Response(400,
           body: jsonEncode({'error': 'repoPath required'}),
@@ -112,8 +113,133 @@ Future<void> main(List<String> args) async {
           headers: {'Content-Type': 'application/json; charset=utf-8'}));
     }
     try {
-      final resp = await getGraph(normalized, limit: limit);
-      return _cors(Response.ok(jsonEncode(resp.toJson()),
+      final resp = await getGraph(normalized,
+          limit: limit, path: path.isEmpty ? null : path);
+      return _cors(Response.ok(resp.encodeJson(),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    } catch (e) {
+      return _cors(Response(500,
+          body: jsonEncode({'error': e.toString()}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+  });
+
+  router.post('/graph/window', (Request req) async {
+    final body = await req.readAsString();
+    final data = jsonDecode(body) as Map<String, dynamic>;
+    final repoPath = _sanitizePath(data['repoPath'] as String?);
+    final start = data['start'] is int ? data['start'] as int : 0;
+    final count = data['count'] is int ? data['count'] as int : 200;
+    if (repoPath.isEmpty) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'repoPath required'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    if (start < 0 || count <= 0 || count > 5000) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'invalid window'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    final normalized = p.normalize(repoPath);
+    final dir = Directory(normalized);
+    if (!dir.existsSync()) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'path not found'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    final gitDir = Directory(p.join(normalized, '.git'));
+    if (!gitDir.existsSync()) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'not a git repo'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    try {
+      final window =
+          await getHistoryWindow(normalized, start: start, count: count);
+      return _cors(Response.ok(jsonEncode(window),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    } catch (e) {
+      return _cors(Response(500,
+          body: jsonEncode({'error': e.toString()}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+  });
+
+  router.post('/stats', (Request req) async {
+    final body = await req.readAsString();
+    final data = jsonDecode(body) as Map<String, dynamic>;
+    final repoPath = _sanitizePath(data['repoPath'] as String?);
+    final commits = data['commits'] is List
+        ? (data['commits'] as List).whereType<String>().toList()
+        : null;
+    final range = data['range'] is String ? data['range'] as String : null;
+    if (repoPath.isEmpty) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'repoPath required'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    if (commits == null && (range == null || range.isEmpty)) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'commits or range required'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    final normalized = p.normalize(repoPath);
+    final dir = Directory(normalized);
+    if (!dir.existsSync()) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'path not found'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    final gitDir = Directory(p.join(normalized, '.git'));
+    if (!gitDir.existsSync()) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'not a git repo'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    try {
+      final stats =
+          await getCommitStats(normalized, commits: commits, range: range);
+      return _cors(Response.ok(jsonEncode(stats),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    } catch (e) {
+      return _cors(Response(500,
+          body: jsonEncode({'error': e.toString()}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+  });
+
+  router.post('/search', (Request req) async {
+    final body = await req.readAsString();
+    final data = jsonDecode(body) as Map<String, dynamic>;
+    final repoPath = _sanitizePath(data['repoPath'] as String?);
+    final query = data['query'] is String ? data['query'] as String : '';
+    final limit = data['limit'] is int ? data['limit'] as int : 200;
+    if (repoPath.isEmpty) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'repoPath required'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    if (limit <= 0 || limit > 5000) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'invalid limit'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    final normalized = p.normalize(repoPath);
+    final dir = Directory(normalized);
+    if (!dir.existsSync()) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'path not found'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    final gitDir = Directory(p.join(normalized, '.git'));
+    if (!gitDir.existsSync()) {
+      return _cors(Response(400,
+          body: jsonEncode({'error': 'not a git repo'}),
+          headers: {'Content-Type': 'application/json; charset=utf-8'}));
+    }
+    try {
+      final result = await searchCommits(normalized, query, limit: limit);
+      return _cors(Response.ok(jsonEncode(result),
           headers: {'Content-Type': 'application/json; charset=utf-8'}));
     } catch (e) {
       return _cors(Response(500,
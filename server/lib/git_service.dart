@@ -1,11 +1,20 @@
+import 'dart:async';
 import 'dart:convert';
 import 'dart:io';
 import 'models.dart';
+import 'native_engine.dart';
 
 final Map<String, GraphResponse> _graphCache = <String, GraphResponse>{};
 
+// `git show-ref --head` as it was when the engine last loaded each
+// repository. The engine keeps a history until told to forget it, so a
+// different listing means the refs moved since and its copy is stale.
+final Map<String, String> _engineRefs = <String, String>{};
+
 void clearCache() {
   _graphCache.clear();
+  _engineRefs.clear();
+  nativeReset();
 }
 
 Future<List<String>> _runGit(List<String> args, String repoPath) async {
@@ -49,14 +58,84 @@ Future<List<Branch>> getBranches(String repoPath) async {
   return result;
 }
 
-Future<GraphResponse> getGraph(String repoPath, {int? limit}) async {
-  final key = '${repoPath}|${limit ?? 0}';
+Future<GraphResponse> getGraph(String repoPath,
+    {int? limit, String? path}) async {
+  final key = '${repoPath}|${limit ?? 0}|${path ?? ''}';
   final cached = _graphCache[key];
   if (cached != null) {
     return cached;
   }
-  final branches = await getBranches(repoPath);
-  final chains = await getBranchChains(repoPath, branches, limit: limit);
+  if (path != null && path.isNotEmpty) {
+    final resp = await _getPathGraph(repoPath, path, limit: limit);
+    _graphCache[key] = resp;
+    return resp;
+  }
+  GraphResponse resp;
+  try {
+    resp = await _getStoreGraph(repoPath, limit: limit);
+  } catch (e) {
+    stderr.writeln(
+        'native engine unavailable for $repoPath, using git log: $e');
+    final branches = await getBranches(repoPath);
+    final chains = await getBranchChains(repoPath, branches, limit: limit);
+    final commits = await _logCommits(repoPath, limit: limit);
+    resp = GraphResponse(commits: commits, branches: branches, chains: chains);
+  }
+  _graphCache[key] = resp;
+  return resp;
+}
+
+// Lists the refs, has the engine forget its copy of the history if it was
+// loaded under different ones, and returns the branches among them.
+Future<List<Branch>> _syncEngineRefs(String repoPath) async {
+  final refs = await _runGit(['show-ref', '--head'], repoPath);
+  final listing = refs.join('\n');
+  if (_engineRefs[repoPath] != listing) {
+    // Loaded under other refs, or by an endpoint that did not record them.
+    nativeForget(repoPath);
+    _engineRefs[repoPath] = listing;
+  }
+  const prefix = 'refs/heads/';
+  final branches = <Branch>[];
+  for (final line in refs) {
+    final space = line.indexOf(' ');
+    if (space < 0 || !line.startsWith(prefix, space + 1)) continue;
+    branches.add(Branch(
+        name: line.substring(space + 1 + prefix.length),
+        head: line.substring(0, space)));
+  }
+  return branches;
+}
+
+// Commits, branches and chains all read from the engine's columnar history,
+// so they describe one set of refs. The response holds the store, not a
+// CommitNode per commit; rows are built while the body is streamed.
+Future<GraphResponse> _getStoreGraph(String repoPath, {int? limit}) async {
+  final branches = await _syncEngineRefs(repoPath);
+  final store = await openCommitStore(repoPath);
+  final chains = <String, List<String>>{};
+  for (final branch in branches) {
+    final row = store.rowOf(branch.head);
+    if (row < 0) {
+      // The refs moved while the history was loading; reload next time.
+      _engineRefs.remove(repoPath);
+      throw Exception('${branch.name} is not in the loaded history');
+    }
+    chains[branch.name] = store.chain(row, limit: limit);
+  }
+  // Off the request path: the first search keystroke then finds the index
+  // already built.
+  unawaited(nativeWarmSearch(repoPath).catchError((Object e) {
+    stderr.writeln('search index warm-up failed for $repoPath: $e');
+  }));
+  return GraphResponse(
+      commits: store.commits(limit: limit),
+      branches: branches,
+      chains: chains);
+}
+
+// Parses `git log` directly, for when the native engine is unavailable.
+Future<List<CommitNode>> _logCommits(String repoPath, {int? limit}) async {
   final logArgs = [
     'log',
     '--all',
@@ -94,10 +173,97 @@ Future<GraphResponse> getGraph(String repoPath, {int? limit}) async {
       ),
     );
   }
-  final resp =
-      GraphResponse(commits: commits, branches: branches, chains: chains);
-  _graphCache[key] = resp;
-  return resp;
+  return commits;
+}
+
+// Graph restricted to commits that touched [path]. The native engine skips
+// most commits with changed-path Bloom filters instead of diffing every tree
+// the way `git log -- <path>` does.
+Future<GraphResponse> _getPathGraph(String repoPath, String path,
+    {int? limit}) async {
+  final branches = await _syncEngineRefs(repoPath);
+  final j = await nativePathFilter(repoPath, path);
+  var commits = (j['commits'] as List).map((e) {
+    final m = e as Map<String, dynamic>;
+    return CommitNode(
+      id: m['id'] as String,
+      parents: (m['parents'] as List).cast<String>(),
+      refs: (m['refs'] as List).cast<String>(),
+      author: m['author'] as String,
+      date: m['date'] as String,
+      subject: m['subject'] as String,
+    );
+  }).toList();
+  final targets = (j['targets'] as Map<String, dynamic>).cast<String, String?>();
+  if (branches.any((b) => !targets.containsKey(b.head))) {
+    // A head the engine did not see: the refs moved while it was loading.
+    _engineRefs.remove(repoPath);
+    throw Exception('branch heads are not in the loaded history');
+  }
+  final chains = _chainsFromCommits(commits, branches, targets);
+  if (limit != null && limit > 0 && commits.length > limit) {
+    commits = commits.sublist(0, limit);
+    for (final name in chains.keys.toList()) {
+      final ids = chains[name]!;
+      if (ids.length > limit) chains[name] = ids.sublist(0, limit);
+    }
+  }
+  return GraphResponse(commits: commits, branches: branches, chains: chains);
+}
+
+// Topo-ordered commits reachable from each branch within [commits], which
+// is what `git log --topo-order <branch> -- <path>` would list.
+Map<String, List<String>> _chainsFromCommits(List<CommitNode> commits,
+    List<Branch> branches, Map<String, String?> targets) {
+  final byId = {for (final c in commits) c.id: c};
+  final result = <String, List<String>>{};
+  for (final b in branches) {
+    final start = targets[b.head];
+    final reachable = <String>{};
+    final stack = <String>[if (start != null) start];
+    while (stack.isNotEmpty) {
+      final id = stack.removeLast();
+      if (!reachable.add(id)) continue;
+      final c = byId[id];
+      if (c != null) stack.addAll(c.parents);
+    }
+    result[b.name] = [
+      for (final c in commits)
+        if (reachable.contains(c.id)) c.id
+    ];
+  }
+  return result;
+}
+
+// Rows [start, start + count) of the full topo-ordered history with their
+// lanes, served by the native engine's checkpointed layout instead of
+// truncating the log with --max-count.
+Future<Map<String, dynamic>> getHistoryWindow(String repoPath,
+    {required int start, required int count}) {
+  return nativeHistoryWindow(repoPath, start, count);
+}
+
+// Files changed and lines added/removed per commit against its first parent.
+// Either [commits] or a `git rev-list` [range] such as `v1..v2` selects the
+// commits; the native engine diffs them in one batch across all cores.
+Future<Map<String, dynamic>> getCommitStats(String repoPath,
+    {List<String>? commits, String? range}) async {
+  var ids = commits ?? <String>[];
+  if (range != null && range.isNotEmpty) {
+    if (range.startsWith('-')) {
+      throw Exception('invalid range');
+    }
+    ids = await _runGit(['rev-list', range, '--'], repoPath);
+  }
+  return nativeCommitStats(repoPath, ids);
+}
+
+// Commits whose subject, author or refs contain every term of [query],
+// answered from the engine's trigram index. Matches carry their row and lane
+// in the full topo order so the viewer can jump to them.
+Future<Map<String, dynamic>> searchCommits(String repoPath, String query,
+    {int limit = 200}) {
+  return nativeSearch(repoPath, query, limit);
 }
 
 List<String> _parseRefs(String decoration) {
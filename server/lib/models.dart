@@ -1,3 +1,5 @@
+import 'dart:convert';
+
 class CommitNode {
   final String id;
   final List<String> parents;
@@ -41,4 +43,24 @@ class GraphResponse {
         'branches': branches.map((e) => e.toJson()).toList(),
         'chains': chains,
       };
+
+  // toJson() as a UTF-8 body, [_encodeBatch] commits at a time. Cached
+  // responses may be backed by the engine's columns, so the encoded body is
+  // never held whole; only one batch of CommitNodes exists at a time.
+  static const int _encodeBatch = 1000;
+  Stream<List<int>> encodeJson() async* {
+    yield utf8.encode('{"branches":${jsonEncode(branches)},'
+        '"chains":${jsonEncode(chains)},"commits":[');
+    for (var i = 0; i < commits.length; i += _encodeBatch) {
+      final end = i + _encodeBatch < commits.length
+          ? i + _encodeBatch
+          : commits.length;
+      final batch = jsonEncode([
+        for (var j = i; j < end; j++) commits[j].toJson(),
+      ]);
+      yield utf8.encode(
+          '${i == 0 ? '' : ','}${batch.substring(1, batch.length - 1)}');
+    }
+    yield utf8.encode(']}');
+  }
 }
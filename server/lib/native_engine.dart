@@ -0,0 +1,485 @@
+import 'dart:collection';
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'models.dart';
+
+// Bindings for the native graph engine built from linux/engine. The library
+// is looked up through GITGRAPH_ENGINE_PATH first, then the default loader
+// search path. Every engine call runs on a helper isolate so a long history
+// load never blocks the request loop.
+
+final class GgBuffer extends Struct {
+  external Pointer<Uint8> data;
+  @Int64()
+  external int size;
+}
+
+// Mirrors GgCommitStore in linux/engine/gitgraph_engine.h.
+final class GgCommitStore extends Struct {
+  @Int64()
+  external int count;
+  @Int32()
+  external int oidSize;
+  external Pointer<Uint8> oids;
+  external Pointer<Uint8> trees;
+  external Pointer<Uint32> parentOffsets;
+  external Pointer<Uint32> parents;
+  @Int64()
+  external int externalCount;
+  external Pointer<Uint32> externalEdges;
+  external Pointer<Uint8> externalOids;
+  external Pointer<Uint32> refOffsets;
+  external Pointer<Uint32> refs;
+  external Pointer<Uint32> authors;
+  external Pointer<Uint32> subjects;
+  external Pointer<Int64> dates;
+  external Pointer<Int16> tzOffsets;
+  @Int64()
+  external int stringCount;
+  external Pointer<Uint32> stringOffsets;
+  external Pointer<Uint8> strings;
+  @Int64()
+  external int memoryBytes;
+}
+
+typedef _AllocC = Pointer<Uint8> Function(Int64 size);
+typedef _AllocDart = Pointer<Uint8> Function(int size);
+typedef _FreeC = Void Function(Pointer<Void> ptr);
+typedef _FreeDart = void Function(Pointer<Void> ptr);
+typedef _WindowC = GgBuffer Function(
+    Pointer<Uint8> repoPath, Int64 start, Int64 count);
+typedef _WindowDart = GgBuffer Function(
+    Pointer<Uint8> repoPath, int start, int count);
+typedef _PathFilterC = GgBuffer Function(
+    Pointer<Uint8> repoPath, Pointer<Uint8> path);
+typedef _PathFilterDart = GgBuffer Function(
+    Pointer<Uint8> repoPath, Pointer<Uint8> path);
+typedef _StatsC = GgBuffer Function(
+    Pointer<Uint8> repoPath, Pointer<Uint8> commitIds);
+typedef _StatsDart = GgBuffer Function(
+    Pointer<Uint8> repoPath, Pointer<Uint8> commitIds);
+typedef _SearchC = GgBuffer Function(
+    Pointer<Uint8> repoPath, Pointer<Uint8> query, Int64 limit);
+typedef _SearchDart = GgBuffer Function(
+    Pointer<Uint8> repoPath, Pointer<Uint8> query, int limit);
+typedef _StoreOpenC = Pointer<GgCommitStore> Function(
+    Pointer<Uint8> repoPath, Pointer<GgBuffer> error);
+typedef _StoreOpenDart = Pointer<GgCommitStore> Function(
+    Pointer<Uint8> repoPath, Pointer<GgBuffer> error);
+typedef _StoreCloseC = Void Function(Pointer<GgCommitStore> store);
+typedef _StoreCloseDart = void Function(Pointer<GgCommitStore> store);
+typedef _FormatDateC = Int64 Function(
+    Int64 time, Int32 tzOffset, Pointer<Uint8> out, Int64 capacity);
+typedef _FormatDateDart = int Function(
+    int time, int tzOffset, Pointer<Uint8> out, int capacity);
+typedef _ResetC = Void Function();
+typedef _ResetDart = void Function();
+typedef _ForgetC = Void Function(Pointer<Uint8> repoPath);
+typedef _ForgetDart = void Function(Pointer<Uint8> repoPath);
+
+class _Engine {
+  final _AllocDart alloc;
+  final _FreeDart free;
+  final _WindowDart historyWindow;
+  final _PathFilterDart pathFilter;
+  final _StatsDart commitStats;
+  final _SearchDart search;
+  final _StoreOpenDart commitStoreOpen;
+  final _StoreCloseDart commitStoreClose;
+  final Pointer<NativeFinalizerFunction> commitStoreFinalizer;
+  final _FormatDateDart formatDate;
+  final _ResetDart reset;
+  final _ForgetDart forget;
+  _Engine(DynamicLibrary lib)
+      : alloc = lib.lookupFunction<_AllocC, _AllocDart>('gg_alloc'),
+        free = lib.lookupFunction<_FreeC, _FreeDart>('gg_free'),
+        historyWindow =
+            lib.lookupFunction<_WindowC, _WindowDart>('gg_history_window'),
+        pathFilter = lib
+            .lookupFunction<_PathFilterC, _PathFilterDart>('gg_path_filter'),
+        commitStats =
+            lib.lookupFunction<_StatsC, _StatsDart>('gg_commit_stats'),
+        search = lib.lookupFunction<_SearchC, _SearchDart>('gg_search'),
+        commitStoreOpen = lib.lookupFunction<_StoreOpenC, _StoreOpenDart>(
+            'gg_commit_store_open'),
+        commitStoreClose = lib.lookupFunction<_StoreCloseC, _StoreCloseDart>(
+            'gg_commit_store_close'),
+        commitStoreFinalizer =
+            lib.lookup<NativeFinalizerFunction>('gg_commit_store_close'),
+        formatDate = lib.lookupFunction<_FormatDateC, _FormatDateDart>(
+            'gg_format_date',
+            isLeaf: true),
+        reset = lib.lookupFunction<_ResetC, _ResetDart>('gg_reset'),
+        forget = lib.lookupFunction<_ForgetC, _ForgetDart>('gg_forget');
+}
+
+// Loaded lazily, and separately in each isolate that touches it.
+late final _Engine _engine = _Engine(_openLibrary());
+
+DynamicLibrary _openLibrary() {
+  final override = Platform.environment['GITGRAPH_ENGINE_PATH'];
+  if (override != null && override.isNotEmpty) {
+    return DynamicLibrary.open(override);
+  }
+  if (Platform.isWindows) return DynamicLibrary.open('gitgraph_engine.dll');
+  if (Platform.isMacOS) return DynamicLibrary.open('libgitgraph_engine.dylib');
+  return DynamicLibrary.open('libgitgraph_engine.so');
+}
+
+Pointer<Uint8> _toNative(String s) {
+  final bytes = utf8.encode(s);
+  final ptr = _engine.alloc(bytes.length + 1);
+  final view = ptr.asTypedList(bytes.length + 1);
+  view.setAll(0, bytes);
+  view[bytes.length] = 0;
+  return ptr;
+}
+
+Map<String, dynamic> _takeJson(GgBuffer buf) {
+  if (buf.data == nullptr) {
+    throw Exception('native engine out of memory');
+  }
+  final text =
+      utf8.decode(Uint8List.fromList(buf.data.asTypedList(buf.size)));
+  _engine.free(buf.data.cast());
+  final j = jsonDecode(text) as Map<String, dynamic>;
+  if (j['error'] != null) {
+    throw Exception(j['error']);
+  }
+  return j;
+}
+
+Map<String, dynamic> _historyWindowSync(String repoPath, int start, int count) {
+  final path = _toNative(repoPath);
+  try {
+    return _takeJson(_engine.historyWindow(path, start, count));
+  } finally {
+    _engine.free(path.cast());
+  }
+}
+
+Future<Map<String, dynamic>> nativeHistoryWindow(
+    String repoPath, int start, int count) {
+  return Isolate.run(() => _historyWindowSync(repoPath, start, count));
+}
+
+Map<String, dynamic> _pathFilterSync(String repoPath, String path) {
+  final repo = _toNative(repoPath);
+  final filter = _toNative(path);
+  try {
+    return _takeJson(_engine.pathFilter(repo, filter));
+  } finally {
+    _engine.free(repo.cast());
+    _engine.free(filter.cast());
+  }
+}
+
+Future<Map<String, dynamic>> nativePathFilter(String repoPath, String path) {
+  return Isolate.run(() => _pathFilterSync(repoPath, path));
+}
+
+Map<String, dynamic> _commitStatsSync(String repoPath, List<String> ids) {
+  final repo = _toNative(repoPath);
+  final list = _toNative(ids.join('\n'));
+  try {
+    return _takeJson(_engine.commitStats(repo, list));
+  } finally {
+    _engine.free(repo.cast());
+    _engine.free(list.cast());
+  }
+}
+
+Future<Map<String, dynamic>> nativeCommitStats(
+    String repoPath, List<String> ids) {
+  return Isolate.run(() => _commitStatsSync(repoPath, ids));
+}
+
+Map<String, dynamic> _searchSync(String repoPath, String query, int limit) {
+  final repo = _toNative(repoPath);
+  final q = _toNative(query);
+  try {
+    return _takeJson(_engine.search(repo, q, limit));
+  } finally {
+    _engine.free(repo.cast());
+    _engine.free(q.cast());
+  }
+}
+
+Future<Map<String, dynamic>> nativeSearch(
+    String repoPath, String query, int limit) {
+  return Isolate.run(() => _searchSync(repoPath, query, limit));
+}
+
+// Builds the repository's lane layout and search index in the engine, so
+// the first /search or /graph/window request does not pay for them.
+Future<void> nativeWarmSearch(String repoPath) async {
+  await nativeSearch(repoPath, '', 0);
+}
+
+int _commitStoreOpenSync(String repoPath) {
+  final path = _toNative(repoPath);
+  final error = _engine.alloc(sizeOf<GgBuffer>()).cast<GgBuffer>();
+  error.ref.data = nullptr;
+  error.ref.size = 0;
+  try {
+    final store = _engine.commitStoreOpen(path, error);
+    if (store == nullptr) {
+      // Throws the engine's message.
+      _takeJson(error.ref);
+      throw Exception('cannot open commit store');
+    }
+    return store.address;
+  } finally {
+    _engine.free(path.cast());
+    _engine.free(error.cast());
+  }
+}
+
+// Loads the repository's history in the engine (on a helper isolate) and
+// returns a read-only view of its columns.
+Future<CommitStore> openCommitStore(String repoPath) async {
+  final address = await Isolate.run(() => _commitStoreOpenSync(repoPath));
+  return CommitStore._(Pointer<GgCommitStore>.fromAddress(address));
+}
+
+const int _noCommit = 0xFFFFFFFF;
+// INT64_MIN: git printed no date for the commit.
+const int _noDate = -0x7FFFFFFFFFFFFFFF - 1;
+const String _hexDigits = '0123456789abcdef';
+// Scratch for gg_format_date; one per isolate, reused for every date.
+const int _dateCapacity = 64;
+late final Pointer<Uint8> _dateScratch = _engine.alloc(_dateCapacity);
+
+// The engine's columnar history: raw ids, CSR parent rows, interned strings
+// and integer dates, read straight out of native memory. Holding it costs
+// the server a few objects however long the history is; rows become
+// CommitNodes, and strings are decoded, only when they are read. The native
+// columns are released by close() or when the store is garbage collected.
+class CommitStore implements Finalizable {
+  static final _finalizer = NativeFinalizer(_engine.commitStoreFinalizer);
+
+  final Pointer<GgCommitStore> _store;
+  final int length;
+  final int memoryBytes;
+  final int _oidSize;
+  bool _closed = false;
+
+  CommitStore._(this._store)
+      : length = _store.ref.count,
+        memoryBytes = _store.ref.memoryBytes,
+        _oidSize = _store.ref.oidSize {
+    _finalizer.attach(this, _store.cast(),
+        detach: this, externalSize: memoryBytes);
+  }
+
+  // Typed views over the native columns; nothing is copied.
+  GgCommitStore get _s => _store.ref;
+  late final Uint8List _oids = _s.oids.asTypedList(length * _oidSize);
+  late final Uint32List _parentOffsets =
+      _s.parentOffsets.asTypedList(length + 1);
+  late final Uint32List _parents =
+      _s.parents.asTypedList(_parentOffsets[length]);
+  late final Uint32List _externalEdges =
+      _s.externalEdges.asTypedList(_s.externalCount);
+  late final Uint8List _externalOids =
+      _s.externalOids.asTypedList(_s.externalCount * _oidSize);
+  late final Uint32List _refOffsets = _s.refOffsets.asTypedList(length + 1);
+  late final Uint32List _refs = _s.refs.asTypedList(_refOffsets[length]);
+  late final Uint32List _authors = _s.authors.asTypedList(length);
+  late final Uint32List _subjects = _s.subjects.asTypedList(length);
+  late final Int64List _dates = _s.dates.asTypedList(length);
+  late final Int16List _tzOffsets = _s.tzOffsets.asTypedList(length);
+  late final Uint32List _stringOffsets =
+      _s.stringOffsets.asTypedList(_s.stringCount + 1);
+  late final Uint8List _strings =
+      _s.strings.asTypedList(_stringOffsets[_s.stringCount]);
+
+  String _hex(Uint8List bytes, int offset) {
+    final codes = List<int>.filled(_oidSize * 2, 0);
+    for (var i = 0; i < _oidSize; i++) {
+      final b = bytes[offset + i];
+      codes[2 * i] = _hexDigits.codeUnitAt(b >> 4);
+      codes[2 * i + 1] = _hexDigits.codeUnitAt(b & 0xF);
+    }
+    return String.fromCharCodes(codes);
+  }
+
+  String _string(int id) => utf8.decode(
+      Uint8List.sublistView(
+          _strings, _stringOffsets[id], _stringOffsets[id + 1]),
+      allowMalformed: true);
+
+  int _externalIndex(int edge) {
+    var lo = 0;
+    var hi = _externalEdges.length;
+    while (lo < hi) {
+      final mid = (lo + hi) >> 1;
+      if (_externalEdges[mid] < edge) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  void _check(int row) {
+    if (_closed) throw StateError('commit store is closed');
+    RangeError.checkValidIndex(row, this, 'row', length);
+  }
+
+  String id(int row) {
+    _check(row);
+    return _hex(_oids, row * _oidSize);
+  }
+
+  // Rows of [row]'s parents in the same history; -1 for parents outside it.
+  List<int> parentRows(int row) {
+    _check(row);
+    return [
+      for (var e = _parentOffsets[row]; e < _parentOffsets[row + 1]; e++)
+        _parents[e] == _noCommit ? -1 : _parents[e]
+    ];
+  }
+
+  List<String> parents(int row) {
+    _check(row);
+    return [
+      for (var e = _parentOffsets[row]; e < _parentOffsets[row + 1]; e++)
+        _parents[e] == _noCommit
+            ? _hex(_externalOids, _externalIndex(e) * _oidSize)
+            : _hex(_oids, _parents[e] * _oidSize)
+    ];
+  }
+
+  List<String> refs(int row) {
+    _check(row);
+    return [
+      for (var i = _refOffsets[row]; i < _refOffsets[row + 1]; i++)
+        _string(_refs[i])
+    ];
+  }
+
+  String author(int row) {
+    _check(row);
+    return _string(_authors[row]);
+  }
+
+  String subject(int row) {
+    _check(row);
+    return _string(_subjects[row]);
+  }
+
+  // Author date as `git log --date=iso` prints it, formatted by the engine.
+  String date(int row) {
+    _check(row);
+    final seconds = _dates[row];
+    if (seconds == _noDate) return '';
+    final n = _engine.formatDate(
+        seconds, _tzOffsets[row], _dateScratch, _dateCapacity);
+    return String.fromCharCodes(_dateScratch.asTypedList(n));
+  }
+
+  // Row of the commit [id], or -1 when it is not in the history. A linear
+  // scan over the raw ids, so the store keeps no per-row index.
+  int rowOf(String id) {
+    if (_closed) throw StateError('commit store is closed');
+    if (id.length != _oidSize * 2) return -1;
+    final raw = Uint8List(_oidSize);
+    for (var i = 0; i < _oidSize; i++) {
+      final b = int.tryParse(id.substring(2 * i, 2 * i + 2), radix: 16);
+      if (b == null) return -1;
+      raw[i] = b;
+    }
+    for (var row = 0; row < length; row++) {
+      final base = row * _oidSize;
+      var i = 0;
+      while (i < _oidSize && _oids[base + i] == raw[i]) {
+        i++;
+      }
+      if (i == _oidSize) return row;
+    }
+    return -1;
+  }
+
+  // Ids of the rows reachable from [head], in row order and at most [limit]
+  // of them (all when null): the branch's `git log --topo-order`, read from
+  // the same history as the rows themselves.
+  List<String> chain(int head, {int? limit}) {
+    _check(head);
+    final reachable = Uint8List(length);
+    final stack = <int>[head];
+    while (stack.isNotEmpty) {
+      final row = stack.removeLast();
+      if (reachable[row] != 0) continue;
+      reachable[row] = 1;
+      for (var e = _parentOffsets[row]; e < _parentOffsets[row + 1]; e++) {
+        if (_parents[e] != _noCommit) stack.add(_parents[e]);
+      }
+    }
+    final ids = <String>[];
+    // Parents always come after their children.
+    for (var row = head; row < length; row++) {
+      if (reachable[row] == 0) continue;
+      if (limit != null && limit > 0 && ids.length >= limit) break;
+      ids.add(id(row));
+    }
+    return ids;
+  }
+
+  CommitNode node(int row) => CommitNode(
+        id: id(row),
+        parents: parents(row),
+        refs: refs(row),
+        author: author(row),
+        date: date(row),
+        subject: subject(row),
+      );
+
+  // The first [limit] rows (all when null) as an unmodifiable list whose
+  // CommitNodes are built on access.
+  List<CommitNode> commits({int? limit}) => _CommitStoreList(
+      this, limit != null && limit > 0 && limit < length ? limit : length);
+
+  void close() {
+    if (_closed) return;
+    _closed = true;
+    _finalizer.detach(this);
+    _engine.commitStoreClose(_store);
+  }
+}
+
+class _CommitStoreList extends UnmodifiableListBase<CommitNode> {
+  final CommitStore _store;
+  @override
+  final int length;
+  _CommitStoreList(this._store, this.length);
+
+  @override
+  CommitNode operator [](int index) {
+    RangeError.checkValidIndex(index, this, 'index', length);
+    return _store.node(index);
+  }
+}
+
+void nativeReset() {
+  try {
+    _engine.reset();
+  } catch (_) {
+    // The engine is optional until an endpoint that needs it is used.
+  }
+}
+
+// Drops the engine's copy of one repository, so the next use reloads it.
+void nativeForget(String repoPath) {
+  final path = _toNative(repoPath);
+  try {
+    _engine.forget(path);
+  } finally {
+    _engine.free(path.cast());
+  }
+}